@@ -1,807 +1,8292 @@
-#include <iostream>
-#include <vector>
-#include <string>
-#include <unordered_map>
-#include <queue>
-#include <stack>
-#include <fstream>
-#include <algorithm>
-#include <climits>
-#include <iomanip>
-
-using namespace std;
-
-// Forward declarations
-class City;
-class Trip;
-
-// Structure to represent an attraction in a city
-struct Attraction {
-    string name;
-    double rating;
-    string type;
-    
-    Attraction(string n = "", double r = 0.0, string t = "") 
-        : name(n), rating(r), type(t) {}
-};
-
-// Structure to represent a hotel in a city
-struct Hotel {
-    string name;
-    double rating;
-    int pricePerNight;
-    
-    Hotel(string n = "", double r = 0.0, int p = 0) 
-        : name(n), rating(r), pricePerNight(p) {}
-};
-
-// City class representing a travel destination
-class City {
-public:
-    string name;
-    string country;
-    double popularity;
-    vector<Hotel> hotels;
-    vector<Attraction> attractions;
-    
-    City(string n = "", string c = "", double p = 0.0) 
-        : name(n), country(c), popularity(p) {}
-    
-    // Add hotel to city
-    void addHotel(const Hotel& hotel) {
-        hotels.push_back(hotel);
-    }
-    
-    // Add attraction to city
-    void addAttraction(const Attraction& attraction) {
-        attractions.push_back(attraction);
-    }
-    
-    // Display city information
-    void displayInfo() const {
-        cout << "\n=== " << name << ", " << country << " ===\n";
-        cout << "Popularity Score: " << popularity << "\n";
-        
-        cout << "\nTop Hotels:\n";
-        for (const auto& hotel : hotels) {
-            cout << "  - " << hotel.name << " (Rating: " << hotel.rating 
-                 << ", $" << hotel.pricePerNight << "/night)\n";
-        }
-        
-        cout << "\nTop Attractions:\n";
-        for (const auto& attraction : attractions) {
-            cout << "  - " << attraction.name << " (" << attraction.type 
-                 << ", Rating: " << attraction.rating << ")\n";
-        }
-    }
-};
-
-// Trip class representing a planned journey
-class Trip {
-public:
-    string source;
-    string destination;
-    int distance;
-    int cost;
-    string date;
-    string status; // "planned", "completed", "cancelled"
-    
-    Trip(string src = "", string dest = "", int dist = 0, int c = 0, string d = "", string s = "planned")
-        : source(src), destination(dest), distance(dist), cost(c), date(d), status(s) {}
-    
-    void displayTrip() const {
-        cout << source << " -> " << destination 
-             << " (Distance: " << distance << "km, Cost: $" << cost 
-             << ", Date: " << date << ", Status: " << status << ")\n";
-    }
-};
-
-// Binary Search Tree Node for City storage
-struct BSTNode {
-    City city;
-    BSTNode* left;
-    BSTNode* right;
-    
-    BSTNode(const City& c) : city(c), left(nullptr), right(nullptr) {}
-};
-
-// Binary Search Tree for City management
-class CityBST {
-private:
-    BSTNode* root;
-    
-    // Helper function for insertion
-    BSTNode* insert(BSTNode* node, const City& city) {
-        if (node == nullptr) {
-            return new BSTNode(city);
-        }
-        
-        if (city.name < node->city.name) {
-            node->left = insert(node->left, city);
-        } else if (city.name > node->city.name) {
-            node->right = insert(node->right, city);
-        }
-        
-        return node;
-    }
-    
-    // Helper function for searching
-    BSTNode* search(BSTNode* node, const string& cityName) {
-        if (node == nullptr || node->city.name == cityName) {
-            return node;
-        }
-        
-        if (cityName < node->city.name) {
-            return search(node->left, cityName);
-        }
-        
-        return search(node->right, cityName);
-    }
-    
-    // Helper function for in-order traversal
-    void inOrder(BSTNode* node, vector<City>& cities) {
-        if (node != nullptr) {
-            inOrder(node->left, cities);
-            cities.push_back(node->city);
-            inOrder(node->right, cities);
-        }
-    }
-    
-public:
-    CityBST() : root(nullptr) {}
-    
-    // Insert a city into BST
-    void insertCity(const City& city) {
-        root = insert(root, city);
-    }
-    
-    // Search for a city by name
-    City* findCity(const string& cityName) {
-        BSTNode* result = search(root, cityName);
-        return result ? &(result->city) : nullptr;
-    }
-    
-    // Get all cities in sorted order (by name)
-    vector<City> getAllCities() {
-        vector<City> cities;
-        inOrder(root, cities);
-        return cities;
-    }
-};
-
-// Heap structure for priority-based city recommendations
-class CityHeap {
-private:
-    vector<City> heap;
-    
-    // Helper functions for heap operations
-    int parent(int i) { return (i - 1) / 2; }
-    int leftChild(int i) { return 2 * i + 1; }
-    int rightChild(int i) { return 2 * i + 2; }
-    
-    // Heapify up (for max heap based on popularity)
-    void heapifyUp(int index) {
-        if (index > 0 && heap[parent(index)].popularity < heap[index].popularity) {
-            swap(heap[parent(index)], heap[index]);
-            heapifyUp(parent(index));
-        }
-    }
-    
-    // Heapify down
-    void heapifyDown(int index) {
-        int maxIndex = index;
-        int left = leftChild(index);
-        int right = rightChild(index);
-        
-        if (left < heap.size() && heap[left].popularity > heap[maxIndex].popularity) {
-            maxIndex = left;
-        }
-        
-        if (right < heap.size() && heap[right].popularity > heap[maxIndex].popularity) {
-            maxIndex = right;
-        }
-        
-        if (index != maxIndex) {
-            swap(heap[index], heap[maxIndex]);
-            heapifyDown(maxIndex);
-        }
-    }
-    
-public:
-    // Insert city into heap
-    void insertCity(const City& city) {
-        heap.push_back(city);
-        heapifyUp(heap.size() - 1);
-    }
-    
-    // Get most popular city (max element)
-    City getTopDestination() {
-        if (heap.empty()) {
-            return City();
-        }
-        
-        City top = heap[0];
-        heap[0] = heap[heap.size() - 1];
-        heap.pop_back();
-        
-        if (!heap.empty()) {
-            heapifyDown(0);
-        }
-        
-        return top;
-    }
-    
-    // Check if heap is empty
-    bool isEmpty() {
-        return heap.empty();
-    }
-    
-    // Get top N destinations without removing them
-    vector<City> getTopNDestinations(int n) {
-        vector<City> result;
-        CityHeap tempHeap = *this; // Copy current heap
-        
-        for (int i = 0; i < n && !tempHeap.isEmpty(); i++) {
-            result.push_back(tempHeap.getTopDestination());
-        }
-        
-        return result;
-    }
-};
-
-// Graph class for route planning using adjacency list
-class RouteGraph {
-private:
-    unordered_map<string, vector<pair<string, int>>> adjList;
-    
-public:
-    // Add an edge between two cities with distance
-    void addRoute(const string& city1, const string& city2, int distance) {
-        adjList[city1].push_back({city2, distance});
-        adjList[city2].push_back({city1, distance}); // Undirected graph
-    }
-    
-    // Dijkstra's algorithm to find shortest path
-    pair<int, vector<string>> findShortestPath(const string& source, const string& destination) {
-        unordered_map<string, int> distances;
-        unordered_map<string, string> previous;
-        priority_queue<pair<int, string>, vector<pair<int, string>>, greater<pair<int, string>>> pq;
-        
-        // Initialize distances
-        for (const auto& pair : adjList) {
-            distances[pair.first] = INT_MAX;
-        }
-        distances[source] = 0;
-        pq.push({0, source});
-        
-        while (!pq.empty()) {
-            int currentDist = pq.top().first;
-            string currentCity = pq.top().second;
-            pq.pop();
-            
-            if (currentCity == destination) break;
-            
-            if (currentDist > distances[currentCity]) continue;
-            
-            for (const auto& neighbor : adjList[currentCity]) {
-                string nextCity = neighbor.first;
-                int weight = neighbor.second;
-                int newDist = currentDist + weight;
-                
-                if (newDist < distances[nextCity]) {
-                    distances[nextCity] = newDist;
-                    previous[nextCity] = currentCity;
-                    pq.push({newDist, nextCity});
-                }
-            }
-        }
-        
-        // Reconstruct path
-        vector<string> path;
-        string current = destination;
-        
-        if (distances[destination] == INT_MAX) {
-            return {-1, path}; // No path found
-        }
-        
-        while (current != source) {
-            path.push_back(current);
-            current = previous[current];
-        }
-        path.push_back(source);
-        reverse(path.begin(), path.end());
-        
-        return {distances[destination], path};
-    }
-    
-    // Display all available routes
-    void displayRoutes() {
-        cout << "\n=== Available Routes ===\n";
-        for (const auto& city : adjList) {
-            cout << city.first << " connects to: ";
-            for (const auto& neighbor : city.second) {
-                cout << neighbor.first << "(" << neighbor.second << "km) ";
-            }
-            cout << "\n";
-        }
-    }
-};
-
-// Sorting algorithms for cities
-class CitySorter {
-public:
-    // Quick Sort by cost (ascending)
-    static void quickSortByCost(vector<Trip>& trips, int low, int high) {
-        if (low < high) {
-            int pi = partitionByCost(trips, low, high);
-            quickSortByCost(trips, low, pi - 1);
-            quickSortByCost(trips, pi + 1, high);
-        }
-    }
-    
-    // Merge Sort by distance (ascending)
-    static void mergeSortByDistance(vector<Trip>& trips, int left, int right) {
-        if (left < right) {
-            int mid = left + (right - left) / 2;
-            mergeSortByDistance(trips, left, mid);
-            mergeSortByDistance(trips, mid + 1, right);
-            mergeByDistance(trips, left, mid, right);
-        }
-    }
-    
-    // Sort cities by popularity (descending)
-    static void sortCitiesByPopularity(vector<City>& cities) {
-        sort(cities.begin(), cities.end(), [](const City& a, const City& b) {
-            return a.popularity > b.popularity;
-        });
-    }
-
-private:
-    // Partition function for Quick Sort
-    static int partitionByCost(vector<Trip>& trips, int low, int high) {
-        int pivot = trips[high].cost;
-        int i = low - 1;
-        
-        for (int j = low; j < high; j++) {
-            if (trips[j].cost <= pivot) {
-                i++;
-                swap(trips[i], trips[j]);
-            }
-        }
-        swap(trips[i + 1], trips[high]);
-        return i + 1;
-    }
-    
-    // Merge function for Merge Sort
-    static void mergeByDistance(vector<Trip>& trips, int left, int mid, int right) {
-        int n1 = mid - left + 1;
-        int n2 = right - mid;
-        
-        vector<Trip> leftArr(n1), rightArr(n2);
-        
-        for (int i = 0; i < n1; i++)
-            leftArr[i] = trips[left + i];
-        for (int j = 0; j < n2; j++)
-            rightArr[j] = trips[mid + 1 + j];
-        
-        int i = 0, j = 0, k = left;
-        
-        while (i < n1 && j < n2) {
-            if (leftArr[i].distance <= rightArr[j].distance) {
-                trips[k] = leftArr[i];
-                i++;
-            } else {
-                trips[k] = rightArr[j];
-                j++;
-            }
-            k++;
-        }
-        
-        while (i < n1) {
-            trips[k] = leftArr[i];
-            i++; k++;
-        }
-        
-        while (j < n2) {
-            trips[k] = rightArr[j];
-            j++; k++;
-        }
-    }
-};
-
-// Main Travel Planner Manager class
-class TravelPlannerManager {
-private:
-    RouteGraph routeGraph;
-    CityBST cityDatabase;
-    CityHeap popularDestinations;
-    stack<Trip> travelHistory;
-    queue<Trip> futureTrips;
-    vector<Trip> allTrips;
-
-public:
-    // Constructor - Initialize with sample data
-    TravelPlannerManager() {
-        initializeSampleData();
-    }
-    
-    // Initialize sample cities and routes
-    void initializeSampleData() {
-        // Create sample cities
-        City paris("Paris", "France", 9.5);
-        paris.addHotel(Hotel("Hotel Ritz", 4.8, 500));
-        paris.addHotel(Hotel("Ibis Budget", 4.2, 80));
-        paris.addAttraction(Attraction("Eiffel Tower", 4.9, "Monument"));
-        paris.addAttraction(Attraction("Louvre Museum", 4.7, "Museum"));
-        
-        City london("London", "UK", 9.2);
-        london.addHotel(Hotel("The Savoy", 4.9, 600));
-        london.addHotel(Hotel("Premier Inn", 4.3, 90));
-        london.addAttraction(Attraction("Big Ben", 4.6, "Monument"));
-        london.addAttraction(Attraction("British Museum", 4.8, "Museum"));
-        
-        City rome("Rome", "Italy", 8.8);
-        rome.addHotel(Hotel("Hotel Eden", 4.7, 400));
-        rome.addHotel(Hotel("B&B Rome", 4.1, 70));
-        rome.addAttraction(Attraction("Colosseum", 4.9, "Historical"));
-        rome.addAttraction(Attraction("Vatican City", 4.8, "Religious"));
-        
-        City tokyo("Tokyo", "Japan", 9.0);
-        tokyo.addHotel(Hotel("Park Hyatt", 4.8, 450));
-        tokyo.addHotel(Hotel("Capsule Hotel", 4.0, 40));
-        tokyo.addAttraction(Attraction("Tokyo Tower", 4.5, "Monument"));
-        tokyo.addAttraction(Attraction("Senso-ji Temple", 4.6, "Religious"));
-        
-        City newyork("New York", "USA", 9.3);
-        newyork.addHotel(Hotel("The Plaza", 4.6, 550));
-        newyork.addHotel(Hotel("YMCA", 3.8, 100));
-        newyork.addAttraction(Attraction("Statue of Liberty", 4.7, "Monument"));
-        newyork.addAttraction(Attraction("Central Park", 4.8, "Park"));
-        
-        // Add cities to BST and Heap
-        cityDatabase.insertCity(paris);
-        cityDatabase.insertCity(london);
-        cityDatabase.insertCity(rome);
-        cityDatabase.insertCity(tokyo);
-        cityDatabase.insertCity(newyork);
-        
-        popularDestinations.insertCity(paris);
-        popularDestinations.insertCity(london);
-        popularDestinations.insertCity(rome);
-        popularDestinations.insertCity(tokyo);
-        popularDestinations.insertCity(newyork);
-        
-        // Add routes between cities (distance in km)
-        routeGraph.addRoute("Paris", "London", 344);
-        routeGraph.addRoute("Paris", "Rome", 1105);
-        routeGraph.addRoute("London", "Rome", 1435);
-        routeGraph.addRoute("Paris", "New York", 5837);
-        routeGraph.addRoute("London", "New York", 5585);
-        routeGraph.addRoute("Rome", "New York", 6905);
-        routeGraph.addRoute("Tokyo", "New York", 10838);
-        routeGraph.addRoute("Paris", "Tokyo", 9714);
-        routeGraph.addRoute("London", "Tokyo", 9560);
-        
-        // Add some sample completed trips to history
-        travelHistory.push(Trip("Paris", "London", 344, 200, "2024-01-15", "completed"));
-        travelHistory.push(Trip("London", "Rome", 1435, 350, "2024-02-20", "completed"));
-        
-        // Add sample future trips
-        futureTrips.push(Trip("Rome", "Tokyo", 9714, 800, "2024-08-15", "planned"));
-        futureTrips.push(Trip("Tokyo", "New York", 10838, 1200, "2024-09-01", "planned"));
-    }
-    
-    // Plan a new trip between two cities
-    void planTrip() {
-        string source, destination, date;
-        
-        cout << "\n=== Plan New Trip ===\n";
-        cout << "Enter source city: ";
-        cin.ignore();
-        getline(cin, source);
-        cout << "Enter destination city: ";
-        getline(cin, destination);
-        cout << "Enter travel date (YYYY-MM-DD): ";
-        getline(cin, date);
-        
-        // Find shortest path using Dijkstra's algorithm
-        auto result = routeGraph.findShortestPath(source, destination);
-        
-        if (result.first == -1) {
-            cout << "No route found between " << source << " and " << destination << "\n";
-            return;
-        }
-        
-        int distance = result.first;
-        vector<string> path = result.second;
-        int estimatedCost = distance * 0.1; // $0.10 per km
-        
-        cout << "\n--- Route Found ---\n";
-        cout << "Path: ";
-        for (size_t i = 0; i < path.size(); i++) {
-            cout << path[i];
-            if (i < path.size() - 1) cout << " -> ";
-        }
-        cout << "\nTotal Distance: " << distance << " km\n";
-        cout << "Estimated Cost: $" << estimatedCost << "\n";
-        
-        // Create and add trip to future trips queue
-        Trip newTrip(source, destination, distance, estimatedCost, date, "planned");
-        futureTrips.push(newTrip);
-        allTrips.push_back(newTrip);
-        
-        cout << "Trip added to your future trips!\n";
-    }
-    
-    // View travel history using stack
-    void viewTravelHistory() {
-        cout << "\n=== Travel History ===\n";
-        
-        if (travelHistory.empty()) {
-            cout << "No travel history available.\n";
-            return;
-        }
-        
-        stack<Trip> tempStack = travelHistory; // Copy to preserve original
-        
-        cout << "Recent trips (most recent first):\n";
-        while (!tempStack.empty()) {
-            tempStack.top().displayTrip();
-            tempStack.pop();
-        }
-        
-        // Option to undo last trip
-        cout << "\nWould you like to undo the last trip? (y/n): ";
-        char choice;
-        cin >> choice;
-        
-        if (choice == 'y' || choice == 'Y') {
-            if (!travelHistory.empty()) {
-                Trip lastTrip = travelHistory.top();
-                travelHistory.pop();
-                cout << "Undone trip: ";
-                lastTrip.displayTrip();
-            }
-        }
-    }
-    
-    // Manage future trips using queue
-    void manageFutureTrips() {
-        cout << "\n=== Future Trips Management ===\n";
-        cout << "1. View upcoming trips\n";
-        cout << "2. Cancel next trip\n";
-        cout << "3. Mark next trip as completed\n";
-        cout << "Enter choice: ";
-        
-        int choice;
-        cin >> choice;
-        
-        switch (choice) {
-            case 1: {
-                if (futureTrips.empty()) {
-                    cout << "No upcoming trips planned.\n";
-                    return;
-                }
-                
-                queue<Trip> tempQueue = futureTrips;
-                cout << "\nUpcoming trips:\n";
-                while (!tempQueue.empty()) {
-                    tempQueue.front().displayTrip();
-                    tempQueue.pop();
-                }
-                break;
-            }
-            
-            case 2: {
-                if (futureTrips.empty()) {
-                    cout << "No trips to cancel.\n";
-                    return;
-                }
-                
-                Trip cancelledTrip = futureTrips.front();
-                futureTrips.pop();
-                cout << "Cancelled trip: ";
-                cancelledTrip.displayTrip();
-                break;
-            }
-            
-            case 3: {
-                if (futureTrips.empty()) {
-                    cout << "No trips to complete.\n";
-                    return;
-                }
-                
-                Trip completedTrip = futureTrips.front();
-                futureTrips.pop();
-                completedTrip.status = "completed";
-                
-                // Add to travel history
-                travelHistory.push(completedTrip);
-                
-                cout << "Completed trip: ";
-                completedTrip.displayTrip();
-                break;
-            }
-            
-            default:
-                cout << "Invalid choice.\n";
-        }
-    }
-    
-    // Search city information using BST
-    void searchCityInfo() {
-        cout << "\n=== City Information Search ===\n";
-        cout << "Enter city name: ";
-        
-        string cityName;
-        cin.ignore();
-        getline(cin, cityName);
-        
-        City* city = cityDatabase.findCity(cityName);
-        
-        if (city) {
-            city->displayInfo();
-        } else {
-            cout << "City '" << cityName << "' not found in database.\n";
-            
-            // Show available cities
-            cout << "\nAvailable cities:\n";
-            vector<City> allCities = cityDatabase.getAllCities();
-            for (const auto& c : allCities) {
-                cout << "- " << c.name << ", " << c.country << "\n";
-            }
-        }
-    }
-    
-    // Get top destination recommendations using heap
-    void getTopDestinations() {
-        cout << "\n=== Top Destination Recommendations ===\n";
-        cout << "How many top destinations would you like to see? ";
-        
-        int n;
-        cin >> n;
-        
-        vector<City> topDestinations = popularDestinations.getTopNDestinations(n);
-        
-        cout << "\nTop " << n << " destinations by popularity:\n";
-        for (size_t i = 0; i < topDestinations.size(); i++) {
-            cout << (i + 1) << ". " << topDestinations[i].name 
-                 << " (Popularity: " << topDestinations[i].popularity << ")\n";
-        }
-    }
-    
-    // Sort and display trips
-    void sortTrips() {
-        if (allTrips.empty()) {
-            cout << "\nNo trips available to sort.\n";
-            return;
-        }
-        
-        cout << "\n=== Sort Trips ===\n";
-        cout << "1. Sort by Cost (Quick Sort)\n";
-        cout << "2. Sort by Distance (Merge Sort)\n";
-        cout << "Enter choice: ";
-        
-        int choice;
-        cin >> choice;
-        
-        vector<Trip> sortedTrips = allTrips; // Copy for sorting
-        
-        switch (choice) {
-            case 1:
-                CitySorter::quickSortByCost(sortedTrips, 0, sortedTrips.size() - 1);
-                cout << "\nTrips sorted by cost (ascending):\n";
-                break;
-                
-            case 2:
-                CitySorter::mergeSortByDistance(sortedTrips, 0, sortedTrips.size() - 1);
-                cout << "\nTrips sorted by distance (ascending):\n";
-                break;
-                
-            default:
-                cout << "Invalid choice.\n";
-                return;
-        }
-        
-        for (const auto& trip : sortedTrips) {
-            trip.displayTrip();
-        }
-    }
-    
-    // Display all available routes
-    void displayRoutes() {
-        routeGraph.displayRoutes();
-    }
-    
-    // Save data to file
-    void saveDataToFile() {
-        ofstream file("travel_data.txt");
-        
-        if (!file.is_open()) {
-            cout << "Error: Could not create save file.\n";
-            return;
-        }
-        
-        file << "=== TRAVEL HISTORY ===\n";
-        stack<Trip> tempStack = travelHistory;
-        while (!tempStack.empty()) {
-            Trip trip = tempStack.top();
-            file << trip.source << "," << trip.destination << "," 
-                 << trip.distance << "," << trip.cost << "," 
-                 << trip.date << "," << trip.status << "\n";
-            tempStack.pop();
-        }
-        
-        file << "\n=== FUTURE TRIPS ===\n";
-        queue<Trip> tempQueue = futureTrips;
-        while (!tempQueue.empty()) {
-            Trip trip = tempQueue.front();
-            file << trip.source << "," << trip.destination << "," 
-                 << trip.distance << "," << trip.cost << "," 
-                 << trip.date << "," << trip.status << "\n";
-            tempQueue.pop();
-        }
-        
-        file.close();
-        cout << "Data saved to travel_data.txt successfully!\n";
-    }
-    
-    // Display main menu
-    void displayMenu() {
-        cout << "\n" << string(50, '=') << "\n";
-        cout << "        SMART TRAVEL PLANNER\n";
-        cout << string(50, '=') << "\n";
-        cout << "1. Plan a Trip (Graph + Dijkstra's)\n";
-        cout << "2. View Travel History (Stack)\n";
-        cout << "3. Manage Future Trips (Queue)\n";
-        cout << "4. Search City Information (BST)\n";
-        cout << "5. Get Top Destinations (Heap)\n";
-        cout << "6. Sort Trips (Sorting Algorithms)\n";
-        cout << "7. Display Available Routes\n";
-        cout << "8. Save Data to File\n";
-        cout << "9. Exit\n";
-        cout << string(50, '=') << "\n";
-        cout << "Enter your choice: ";
-    }
-    
-    // Main program loop
-    void run() {
-        int choice;
-        
-        do {
-            displayMenu();
-            cin >> choice;
-            
-            switch (choice) {
-                case 1: planTrip(); break;
-                case 2: viewTravelHistory(); break;
-                case 3: manageFutureTrips(); break;
-                case 4: searchCityInfo(); break;
-                case 5: getTopDestinations(); break;
-                case 6: sortTrips(); break;
-                case 7: displayRoutes(); break;
-                case 8: saveDataToFile(); break;
-                case 9: cout << "Thank you for using Smart Travel Planner!\n"; break;
-                default: cout << "Invalid choice. Please try again.\n";
-            }
-            
-            if (choice != 9) {
-                cout << "\nPress Enter to continue...";
-                cin.ignore();
-                cin.get();
-            }
-            
-        } while (choice != 9);
-    }
-};
-
-// Main function
-int main() {
-    cout << "Welcome to Smart Travel Planner!\n";
-    cout << "Initializing system with sample data...\n";
-    
-    TravelPlannerManager planner;
-    planner.run();
-    
-    return 0;
+#include <iostream>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <queue>
+#include <stack>
+#include <fstream>
+#include <algorithm>
+#include <climits>
+#include <limits>
+#include <iomanip>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <memory>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <array>
+#include <map>
+#include <set>
+#include <cstdio>
+#include <cstring>
+#include <charconv>
+#include <string_view>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Forward declarations
+class City;
+class Trip;
+
+// Structure to represent an attraction in a city
+struct Attraction {
+    string name;
+    double rating;
+    string type;
+    
+    Attraction(string n = "", double r = 0.0, string t = "") 
+        : name(n), rating(r), type(t) {}
+};
+
+// Structure to represent a hotel in a city
+struct Hotel {
+    string name;
+    double rating;
+    int pricePerNight;
+    
+    Hotel(string n = "", double r = 0.0, int p = 0) 
+        : name(n), rating(r), pricePerNight(p) {}
+};
+
+// City class representing a travel destination
+class City {
+public:
+    string name;
+    string country;
+    double popularity;
+    vector<Hotel> hotels;
+    vector<Attraction> attractions;
+    double latitude;   // optional, NaN when unknown
+    double longitude;
+    
+    City(string n = "", string c = "", double p = 0.0) 
+        : name(n), country(c), popularity(p), latitude(NAN), longitude(NAN) {}
+    
+    // Set geographic coordinates in degrees
+    void setCoordinates(double lat, double lon) {
+        latitude = lat;
+        longitude = lon;
+    }
+    
+    bool hasCoordinates() const {
+        return !std::isnan(latitude) && !std::isnan(longitude);
+    }
+    
+    // Add hotel to city
+    void addHotel(const Hotel& hotel) {
+        hotels.push_back(hotel);
+    }
+    
+    // Add attraction to city
+    void addAttraction(const Attraction& attraction) {
+        attractions.push_back(attraction);
+    }
+    
+    // Display city information
+    void displayInfo() const {
+        cout << "\n=== " << name << ", " << country << " ===\n";
+        cout << "Popularity Score: " << popularity << "\n";
+        
+        cout << "\nTop Hotels:\n";
+        for (const auto& hotel : hotels) {
+            cout << "  - " << hotel.name << " (Rating: " << hotel.rating 
+                 << ", $" << hotel.pricePerNight << "/night)\n";
+        }
+        
+        cout << "\nTop Attractions:\n";
+        for (const auto& attraction : attractions) {
+            cout << "  - " << attraction.name << " (" << attraction.type 
+                 << ", Rating: " << attraction.rating << ")\n";
+        }
+    }
+};
+
+// Non-owning view over a contiguous array, for read-only listings that
+// should not copy their elements
+template <typename T>
+class ArrayView {
+private:
+    const T* first;
+    size_t count;
+    
+public:
+    ArrayView(const T* data = nullptr, size_t size = 0) : first(data), count(size) {}
+    
+    const T* begin() const { return first; }
+    const T* end() const { return first + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T& operator[](size_t i) const { return first[i]; }
+};
+
+// Immutable singly linked stack whose versions share structure: push and
+// pop return a new stack in O(1) and leave the old one intact, so keeping
+// a snapshot of a history is a pointer copy rather than a full copy.
+// Iteration runs from the most recent element.
+template <typename T>
+class PersistentStack {
+private:
+    struct Node {
+        T value;
+        shared_ptr<const Node> next;
+        
+        Node(const T& v, shared_ptr<const Node> n) : value(v), next(move(n)) {}
+    };
+    
+    shared_ptr<const Node> head;
+    size_t count = 0;
+    
+    PersistentStack(shared_ptr<const Node> node, size_t size) : head(move(node)), count(size) {}
+    
+public:
+    class const_iterator {
+    private:
+        const Node* node;
+        
+    public:
+        typedef forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const T* pointer;
+        typedef const T& reference;
+        
+        explicit const_iterator(const Node* n = nullptr) : node(n) {}
+        
+        const T& operator*() const { return node->value; }
+        const T* operator->() const { return &node->value; }
+        const_iterator& operator++() { node = node->next.get(); return *this; }
+        bool operator==(const const_iterator& other) const { return node == other.node; }
+        bool operator!=(const const_iterator& other) const { return node != other.node; }
+    };
+    
+    PersistentStack() = default;
+    PersistentStack(const PersistentStack&) = default;
+    PersistentStack(PersistentStack&&) = default;
+    PersistentStack& operator=(const PersistentStack&) = default;
+    PersistentStack& operator=(PersistentStack&&) = default;
+    
+    // Release unshared nodes iteratively; the default recursive release
+    // would overflow the call stack on long histories
+    ~PersistentStack() {
+        shared_ptr<const Node> node = move(head);
+        while (node && node.use_count() == 1) {
+            shared_ptr<const Node> next = node->next;
+            node = move(next);
+        }
+    }
+    
+    bool empty() const {
+        return !head;
+    }
+    
+    size_t size() const {
+        return count;
+    }
+    
+    const T& top() const {
+        return head->value;
+    }
+    
+    [[nodiscard]] PersistentStack push(const T& value) const {
+        return PersistentStack(make_shared<const Node>(value, head), count + 1);
+    }
+    
+    [[nodiscard]] PersistentStack pop() const {
+        return PersistentStack(head->next, count - 1);
+    }
+    
+    const_iterator begin() const {
+        return const_iterator(head.get());
+    }
+    
+    const_iterator end() const {
+        return const_iterator();
+    }
+};
+
+// B-tree ordered index for City management. Cities live in a deque so
+// pointers returned by findCity stay valid; the tree holds their names
+// and addresses in wide nodes, keeping lookups at O(log n) depth with
+// few cache misses regardless of insertion order.
+class CityIndex {
+private:
+    static const int MIN_DEGREE = 16;
+    static const int MAX_KEYS = 2 * MIN_DEGREE - 1;
+    
+    struct Node {
+        int count = 0;
+        bool leaf = true;
+        string keys[MAX_KEYS];
+        City* values[MAX_KEYS];
+        unique_ptr<Node> children[MAX_KEYS + 1];
+    };
+    
+    unique_ptr<Node> root;
+    deque<City> storage;
+    
+    // First slot in node whose key is not less than name
+    static int lowerBound(const Node* node, const string& name) {
+        return lower_bound(node->keys, node->keys + node->count, name) - node->keys;
+    }
+    
+    // Split the full child at slot i of parent, lifting its median key
+    static void splitChild(Node* parent, int i) {
+        Node* full = parent->children[i].get();
+        auto right = make_unique<Node>();
+        right->leaf = full->leaf;
+        right->count = MIN_DEGREE - 1;
+        
+        for (int j = 0; j < MIN_DEGREE - 1; j++) {
+            right->keys[j] = move(full->keys[j + MIN_DEGREE]);
+            right->values[j] = full->values[j + MIN_DEGREE];
+        }
+        if (!full->leaf) {
+            for (int j = 0; j < MIN_DEGREE; j++) {
+                right->children[j] = move(full->children[j + MIN_DEGREE]);
+            }
+        }
+        full->count = MIN_DEGREE - 1;
+        
+        for (int j = parent->count; j > i; j--) {
+            parent->children[j + 1] = move(parent->children[j]);
+        }
+        parent->children[i + 1] = move(right);
+        for (int j = parent->count - 1; j >= i; j--) {
+            parent->keys[j + 1] = move(parent->keys[j]);
+            parent->values[j + 1] = parent->values[j];
+        }
+        parent->keys[i] = move(full->keys[MIN_DEGREE - 1]);
+        parent->values[i] = full->values[MIN_DEGREE - 1];
+        parent->count++;
+    }
+    
+    // In-order walk of keys in [from, ...) until visit returns false
+    template <typename Visitor>
+    static bool scanFrom(const Node* node, const string& from, Visitor& visit) {
+        int i = lowerBound(node, from);
+        for (; i < node->count; i++) {
+            if (!node->leaf && !scanFrom(node->children[i].get(), from, visit)) return false;
+            if (!visit(*node->values[i])) return false;
+        }
+        return node->leaf || scanFrom(node->children[i].get(), from, visit);
+    }
+    
+    // Deep enough for 16^16 keys; lets iterators avoid heap allocation
+    static const int MAX_DEPTH = 16;
+    
+public:
+    // In-order iterator; holds the root-to-leaf path in a fixed array
+    class const_iterator {
+    private:
+        struct Frame {
+            const Node* node;
+            int slot;  // key to visit once the subtree left of it is done
+        };
+        Frame frames[MAX_DEPTH];
+        int depth = 0;
+        
+        void descendLeftmost(const Node* node) {
+            while (node) {
+                frames[depth++] = {node, 0};
+                node = node->leaf ? nullptr : node->children[0].get();
+            }
+            skipExhausted();
+        }
+        
+        void skipExhausted() {
+            while (depth > 0 && frames[depth - 1].slot >= frames[depth - 1].node->count) depth--;
+        }
+        
+        friend class CityIndex;
+        
+    public:
+        typedef forward_iterator_tag iterator_category;
+        typedef City value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const City* pointer;
+        typedef const City& reference;
+        
+        const City& operator*() const {
+            const Frame& top = frames[depth - 1];
+            return *top.node->values[top.slot];
+        }
+        
+        const City* operator->() const {
+            return &**this;
+        }
+        
+        const_iterator& operator++() {
+            Frame& top = frames[depth - 1];
+            if (top.node->leaf) {
+                top.slot++;
+                skipExhausted();
+            } else {
+                top.slot++;
+                descendLeftmost(top.node->children[top.slot].get());
+            }
+            return *this;
+        }
+        
+        bool operator==(const const_iterator& other) const {
+            if (depth != other.depth) return false;
+            return depth == 0 || (frames[depth - 1].node == other.frames[depth - 1].node &&
+                                  frames[depth - 1].slot == other.frames[depth - 1].slot);
+        }
+        
+        bool operator!=(const const_iterator& other) const {
+            return !(*this == other);
+        }
+    };
+    
+    CityIndex() = default;
+    CityIndex(const CityIndex&) = delete;
+    CityIndex& operator=(const CityIndex&) = delete;
+    
+    // Insert a city; a name that is already present is left unchanged
+    void insertCity(const City& city) {
+        if (findCity(city.name)) {
+            return;
+        }
+        storage.push_back(city);
+        City* stored = &storage.back();
+        
+        if (!root) {
+            root = make_unique<Node>();
+        }
+        if (root->count == MAX_KEYS) {
+            auto newRoot = make_unique<Node>();
+            newRoot->leaf = false;
+            newRoot->children[0] = move(root);
+            root = move(newRoot);
+            splitChild(root.get(), 0);
+        }
+        
+        // Descend, splitting full nodes ahead of time so a slot is free
+        Node* node = root.get();
+        while (!node->leaf) {
+            int i = lowerBound(node, city.name);
+            if (node->children[i]->count == MAX_KEYS) {
+                splitChild(node, i);
+                if (node->keys[i] < city.name) i++;
+            }
+            node = node->children[i].get();
+        }
+        
+        int i = lowerBound(node, city.name);
+        for (int j = node->count; j > i; j--) {
+            node->keys[j] = move(node->keys[j - 1]);
+            node->values[j] = node->values[j - 1];
+        }
+        node->keys[i] = city.name;
+        node->values[i] = stored;
+        node->count++;
+    }
+    
+    // Search for a city by name
+    City* findCity(const string& cityName) const {
+        const Node* node = root.get();
+        while (node) {
+            int i = lowerBound(node, cityName);
+            if (i < node->count && node->keys[i] == cityName) {
+                return node->values[i];
+            }
+            node = node->leaf ? nullptr : node->children[i].get();
+        }
+        return nullptr;
+    }
+    
+    size_t size() const {
+        return storage.size();
+    }
+    
+    const_iterator begin() const {
+        const_iterator it;
+        it.descendLeftmost(root.get());
+        return it;
+    }
+    
+    const_iterator end() const {
+        return const_iterator();
+    }
+    
+    // Iterator to the first city whose name is not less than name
+    const_iterator lowerBound(const string& name) const {
+        const_iterator it;
+        for (const Node* node = root.get(); node;) {
+            int i = lowerBound(node, name);
+            it.frames[it.depth++] = {node, i};
+            node = node->leaf ? nullptr : node->children[i].get();
+        }
+        it.skipExhausted();
+        return it;
+    }
+    
+    // Visit every city in name order without copying
+    template <typename Visitor>
+    void forEachCity(Visitor visit) const {
+        for (const City& city : *this) visit(city);
+    }
+    
+    // Visit the cities whose names fall between from and to in sorted
+    // order. The upper bound also admits names it prefixes, so "L".."P"
+    // includes Paris.
+    template <typename Visitor>
+    void forEachInRange(const string& from, const string& to, Visitor visit) const {
+        if (!root) return;
+        auto bounded = [&](const City& city) {
+            if (city.name > to && city.name.compare(0, to.size(), to) != 0) return false;
+            visit(city);
+            return true;
+        };
+        scanFrom(root.get(), from, bounded);
+    }
+    
+    // Copying variant of forEachInRange
+    vector<City> getCitiesInRange(const string& from, const string& to) const {
+        vector<City> cities;
+        forEachInRange(from, to, [&](const City& city) { cities.push_back(city); });
+        return cities;
+    }
+    
+    // Get all cities in sorted order (by name); prefer forEachCity or
+    // iteration for read-only listings
+    vector<City> getAllCities() const {
+        vector<City> cities;
+        cities.reserve(storage.size());
+        forEachCity([&](const City& city) { cities.push_back(city); });
+        return cities;
+    }
+};
+
+// Interning table mapping city names to dense integer IDs
+class CityInterner {
+private:
+    unordered_map<string, uint32_t> ids;
+    vector<string> names;
+    
+public:
+    static constexpr uint32_t INVALID_ID = UINT32_MAX;
+    
+    // Return the ID for a name, assigning the next free one if it is new
+    uint32_t intern(const string& name) {
+        auto it = ids.find(name);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        
+        uint32_t id = names.size();
+        ids.emplace(name, id);
+        names.push_back(name);
+        return id;
+    }
+    
+    // Look up a name without inserting it
+    uint32_t find(const string& name) const {
+        auto it = ids.find(name);
+        return it == ids.end() ? INVALID_ID : it->second;
+    }
+    
+    const string& name(uint32_t id) const {
+        return names[id];
+    }
+    
+    uint32_t size() const {
+        return names.size();
+    }
+};
+
+// Lifecycle state of a trip
+enum class TripStatus : uint8_t { Planned, Completed, Cancelled };
+
+// Trip class representing a planned journey. Kept to 24 bytes so that
+// millions of trips sort and store cheaply: cities are IDs into the
+// planner's CityInterner and the date is a day number since 1970-01-01.
+// Text only appears when a trip is displayed or persisted.
+class Trip {
+public:
+    uint32_t source;
+    uint32_t destination;
+    int32_t day;
+    int32_t distance;
+    int32_t cost;
+    TripStatus status;
+    
+    Trip(uint32_t src = CityInterner::INVALID_ID, uint32_t dest = CityInterner::INVALID_ID, int32_t dist = 0,
+         int32_t c = 0, int32_t d = 0, TripStatus s = TripStatus::Planned)
+        : source(src), destination(dest), day(d), distance(dist), cost(c), status(s) {}
+    
+    // Days since 1970-01-01 of a proleptic Gregorian date
+    static int32_t dayNumber(int year, unsigned month, unsigned dayOfMonth) {
+        year -= month <= 2;
+        int era = (year >= 0 ? year : year - 399) / 400;
+        unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+        unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + dayOfMonth - 1;
+        unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + static_cast<int32_t>(dayOfEra) - 719468;
+    }
+    
+    // Parse "YYYY-MM-DD" into a day number; rejects impossible dates
+    static bool parseDate(string_view text, int32_t& result) {
+        int year;
+        unsigned month, dayOfMonth;
+        if (text.size() != 10 || text[4] != '-' || text[7] != '-') return false;
+        auto number = [&](size_t from, size_t length, auto& value) {
+            auto parsed = from_chars(text.data() + from, text.data() + from + length, value);
+            return parsed.ec == errc() && parsed.ptr == text.data() + from + length;
+        };
+        if (!number(0, 4, year) || !number(5, 2, month) || !number(8, 2, dayOfMonth)) return false;
+        if (month < 1 || month > 12 || dayOfMonth < 1) return false;
+        
+        static const unsigned monthDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+        if (dayOfMonth > monthDays[month - 1] + (month == 2 && leap)) return false;
+        result = dayNumber(year, month, dayOfMonth);
+        return true;
+    }
+    
+    // Inverse of dayNumber
+    static void civilDate(int32_t days, int& year, unsigned& month, unsigned& dayOfMonth) {
+        int32_t z = days + 719468;
+        int era = (z >= 0 ? z : z - 146096) / 146097;
+        unsigned dayOfEra = static_cast<unsigned>(z - era * 146097);
+        unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        unsigned mp = (5 * dayOfYear + 2) / 153;
+        dayOfMonth = dayOfYear - (153 * mp + 2) / 5 + 1;
+        month = mp < 10 ? mp + 3 : mp - 9;
+        year = static_cast<int>(yearOfEra) + era * 400 + (month <= 2);
+    }
+    
+    // Months since year 0 (year * 12 + month - 1), for grouping by month
+    static int32_t monthNumber(int32_t days) {
+        int year;
+        unsigned month, dayOfMonth;
+        civilDate(days, year, month, dayOfMonth);
+        return year * 12 + static_cast<int32_t>(month) - 1;
+    }
+    
+    // Day number formatted as "YYYY-MM-DD"
+    static string formatDate(int32_t days) {
+        int year;
+        unsigned month, dayOfMonth;
+        civilDate(days, year, month, dayOfMonth);
+        
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u", year, month, dayOfMonth);
+        return buffer;
+    }
+    
+    static const char* statusName(TripStatus status) {
+        switch (status) {
+            case TripStatus::Completed: return "completed";
+            case TripStatus::Cancelled: return "cancelled";
+            default: return "planned";
+        }
+    }
+    
+    static bool parseStatus(string_view text, TripStatus& result) {
+        for (TripStatus status : {TripStatus::Planned, TripStatus::Completed, TripStatus::Cancelled}) {
+            if (text == statusName(status)) {
+                result = status;
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    void displayTrip(const CityInterner& names) const {
+        cout << names.name(source) << " -> " << names.name(destination)
+             << " (Distance: " << distance << "km, Cost: $" << cost 
+             << ", Date: " << formatDate(day) << ", Status: " << statusName(status) << ")\n";
+    }
+};
+
+static_assert(sizeof(Trip) == 24, "Trip is meant to stay at 24 bytes");
+
+// Max-heap ranking of cities by popularity. The heap holds only
+// (popularity, city id) pairs; names live in an interning table and each
+// id's heap slot is tracked so scores can move in either direction.
+class CityHeap {
+public:
+    struct Entry {
+        double popularity;
+        uint32_t cityId;
+    };
+    
+private:
+    vector<Entry> heap;
+    vector<uint32_t> position;  // heap slot of each city id
+    CityInterner names;
+    
+    // Helper functions for heap operations
+    static size_t parent(size_t i) { return (i - 1) / 2; }
+    static size_t leftChild(size_t i) { return 2 * i + 1; }
+    static size_t rightChild(size_t i) { return 2 * i + 2; }
+    
+    void place(size_t slot, const Entry& entry) {
+        heap[slot] = entry;
+        position[entry.cityId] = slot;
+    }
+    
+    // Heapify up (for max heap based on popularity)
+    void heapifyUp(size_t index) {
+        Entry entry = heap[index];
+        while (index > 0 && heap[parent(index)].popularity < entry.popularity) {
+            place(index, heap[parent(index)]);
+            index = parent(index);
+        }
+        place(index, entry);
+    }
+    
+    // Heapify down
+    void heapifyDown(size_t index) {
+        Entry entry = heap[index];
+        while (leftChild(index) < heap.size()) {
+            size_t maxIndex = leftChild(index);
+            size_t right = rightChild(index);
+            if (right < heap.size() && heap[right].popularity > heap[maxIndex].popularity) {
+                maxIndex = right;
+            }
+            if (heap[maxIndex].popularity <= entry.popularity) break;
+            place(index, heap[maxIndex]);
+            index = maxIndex;
+        }
+        place(index, entry);
+    }
+    
+public:
+    static constexpr uint32_t ABSENT = UINT32_MAX;
+    
+    // Pre-size for a known number of cities
+    void reserve(size_t count) {
+        heap.reserve(count);
+        position.reserve(count);
+    }
+    
+    // Insert city into heap; re-inserting a city updates its score
+    void insertCity(const City& city) {
+        uint32_t id = names.intern(city.name);
+        if (id < position.size() && position[id] != ABSENT) {
+            updatePopularity(city.name, city.popularity);
+            return;
+        }
+        if (id >= position.size()) {
+            position.resize(id + 1, ABSENT);
+        }
+        heap.push_back({city.popularity, id});
+        position[id] = heap.size() - 1;
+        heapifyUp(heap.size() - 1);
+    }
+    
+    // Change a city's score, sifting it up or down; false if unknown
+    bool updatePopularity(const string& cityName, double score) {
+        uint32_t id = names.find(cityName);
+        if (id == CityInterner::INVALID_ID || id >= position.size() || position[id] == ABSENT) {
+            return false;
+        }
+        
+        size_t slot = position[id];
+        double old = heap[slot].popularity;
+        heap[slot].popularity = score;
+        if (score > old) heapifyUp(slot);
+        else if (score < old) heapifyDown(slot);
+        return true;
+    }
+    
+    // Current score of a city, or NaN when it is not ranked
+    double popularityOf(const string& cityName) const {
+        uint32_t id = names.find(cityName);
+        if (id == CityInterner::INVALID_ID || id >= position.size() || position[id] == ABSENT) {
+            return NAN;
+        }
+        return heap[position[id]].popularity;
+    }
+    
+    // Remove and return the most popular city as (name, popularity)
+    pair<string, double> getTopDestination() {
+        if (heap.empty()) {
+            return {"", 0.0};
+        }
+        
+        Entry top = heap[0];
+        position[top.cityId] = ABSENT;
+        Entry last = heap.back();
+        heap.pop_back();
+        
+        if (!heap.empty()) {
+            place(0, last);
+            heapifyDown(0);
+        }
+        
+        return {names.name(top.cityId), top.popularity};
+    }
+    
+    // Check if heap is empty
+    bool isEmpty() const {
+        return heap.empty();
+    }
+    
+    size_t size() const {
+        return heap.size();
+    }
+    
+    const string& cityName(uint32_t cityId) const {
+        return names.name(cityId);
+    }
+    
+    // Ranking entries in heap order, without copying
+    ArrayView<Entry> entries() const {
+        return ArrayView<Entry>(heap.data(), heap.size());
+    }
+    
+    // Visit the n most popular cities as (name, popularity), best first, in
+    // O(n log n) without touching the rest of the heap. Candidates come from
+    // a frontier of heap slots: the root, then the children of each visited
+    // slot, since a slot can only be ranked after its parent.
+    template <typename Visitor>
+    void forEachTopDestination(size_t n, Visitor visit) const {
+        thread_local vector<uint32_t> frontier;
+        frontier.clear();
+        auto lessPopular = [this](uint32_t a, uint32_t b) {
+            return heap[a].popularity < heap[b].popularity;
+        };
+        
+        if (!heap.empty()) frontier.push_back(0);
+        for (size_t visited = 0; visited < n && !frontier.empty(); visited++) {
+            pop_heap(frontier.begin(), frontier.end(), lessPopular);
+            uint32_t slot = frontier.back();
+            frontier.pop_back();
+            visit(names.name(heap[slot].cityId), heap[slot].popularity);
+            
+            for (size_t child = leftChild(slot); child <= rightChild(slot) && child < heap.size(); child++) {
+                frontier.push_back(child);
+                push_heap(frontier.begin(), frontier.end(), lessPopular);
+            }
+        }
+    }
+    
+    // Get top N destinations as (name, popularity) without removing them
+    vector<pair<string, double>> getTopNDestinations(int n) const {
+        vector<pair<string, double>> result;
+        forEachTopDestination(max(n, 0), [&](const string& name, double popularity) {
+            result.push_back({name, popularity});
+        });
+        return result;
+    }
+};
+
+// Directed half of an undirected route, as recorded by addRoute
+struct RouteEdge {
+    uint32_t from;
+    uint32_t to;
+    int distance;
+};
+
+enum class TravelMode : uint8_t { Road, Rail, Air, Ferry };
+
+// Per-route properties beyond the distance used for shortest paths
+struct RouteAttributes {
+    int distance = 0;  // km
+    int price = 0;     // whole dollars
+    int duration = 0;  // minutes
+    TravelMode mode = TravelMode::Road;
+    
+    // Defaults for a route known only by its length: $0.10 per km at 80 km/h
+    static RouteAttributes byRoad(int distance) {
+        return {distance, distance / 10, distance * 3 / 4, TravelMode::Road};
+    }
+    
+    static const char* modeName(TravelMode mode) {
+        switch (mode) {
+            case TravelMode::Rail: return "Rail";
+            case TravelMode::Air: return "Air";
+            case TravelMode::Ferry: return "Ferry";
+            default: return "Road";
+        }
+    }
+    
+    static bool parseMode(string_view text, TravelMode& result) {
+        const TravelMode modes[] = {TravelMode::Road, TravelMode::Rail, TravelMode::Air, TravelMode::Ferry};
+        for (TravelMode mode : modes) {
+            string_view name = modeName(mode);
+            if (text.size() == name.size() &&
+                equal(text.begin(), text.end(), name.begin(), [](char a, char b) { return tolower(a) == tolower(b); })) {
+                result = mode;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Frozen compressed-sparse-row adjacency: the neighbors of node u are
+// targets[offsets[u] .. offsets[u + 1]) with matching weights
+struct CSRGraph {
+    vector<uint32_t> offsets;
+    vector<uint32_t> targets;
+    vector<int> weights;
+    
+    uint32_t nodeCount() const {
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+    
+    // Counting-sort the edge list by source; keeps insertion order per node.
+    // slotEdges, when given, receives the edge-list index of every slot.
+    void build(uint32_t nodeCount, const vector<RouteEdge>& edges, vector<uint32_t>* slotEdges = nullptr) {
+        offsets.assign(nodeCount + 1, 0);
+        for (const auto& edge : edges) {
+            offsets[edge.from + 1]++;
+        }
+        for (uint32_t i = 0; i < nodeCount; i++) {
+            offsets[i + 1] += offsets[i];
+        }
+        
+        targets.resize(edges.size());
+        weights.resize(edges.size());
+        if (slotEdges) slotEdges->resize(edges.size());
+        vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (uint32_t i = 0; i < edges.size(); i++) {
+            const RouteEdge& edge = edges[i];
+            uint32_t slot = cursor[edge.from]++;
+            targets[slot] = edge.to;
+            weights[slot] = edge.distance;
+            if (slotEdges) (*slotEdges)[slot] = i;
+        }
+    }
+};
+
+// Search strategy used by RouteGraph::findShortestPath
+enum class SearchMode {
+    Dijkstra,       // one-sided search from the source
+    Bidirectional,  // simultaneous searches from source and destination
+    AStar,          // goal-directed search using great-circle distance
+    Hierarchy,      // upward search over a preprocessed contraction hierarchy
+    Landmarks       // goal-directed search using precomputed landmark bounds (ALT)
+};
+
+// Per-query counters reported by the route searches
+struct SearchStats {
+    uint32_t settledNodes = 0;
+    uint32_t droppedLabels = 0;  // multi-criteria labels refused by a full bag
+};
+
+// Great-circle distance in km between two coordinates (haversine formula)
+double greatCircleKm(double lat1, double lon1, double lat2, double lon2) {
+    const double earthRadiusKm = 6371.0;
+    const double toRad = M_PI / 180.0;
+    double dLat = (lat2 - lat1) * toRad;
+    double dLon = (lon2 - lon1) * toRad;
+    double a = sin(dLat / 2) * sin(dLat / 2) +
+               cos(lat1 * toRad) * cos(lat2 * toRad) * sin(dLon / 2) * sin(dLon / 2);
+    return 2 * earthRadiusKm * asin(min(1.0, sqrt(a)));
+}
+
+// Fixed set of worker threads for splitting index ranges across cores.
+// parallelFor blocks until every index is done; the calling thread takes
+// part as worker 0. Calls must not be nested from inside a job.
+class ThreadPool {
+private:
+    vector<thread> workers;
+    mutex stateMutex;
+    mutex runMutex;
+    condition_variable wake;
+    condition_variable finished;
+    
+    const function<void(size_t, unsigned)>* job = nullptr;
+    size_t jobSize = 0;
+    atomic<size_t> nextIndex{0};
+    unsigned busyWorkers = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+    
+    void drain(unsigned worker) {
+        for (size_t i = nextIndex++; i < jobSize; i = nextIndex++) {
+            (*job)(i, worker);
+        }
+    }
+    
+    void workerLoop(unsigned worker) {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                unique_lock<mutex> lock(stateMutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            drain(worker);
+            {
+                lock_guard<mutex> lock(stateMutex);
+                if (--busyWorkers == 0) finished.notify_one();
+            }
+        }
+    }
+    
+public:
+    explicit ThreadPool(unsigned threads = thread::hardware_concurrency()) {
+        for (unsigned i = 1; i < max(1u, threads); i++) {
+            workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+    
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(stateMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+    
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    // Number of workers, including the calling thread
+    unsigned size() const {
+        return workers.size() + 1;
+    }
+    
+    // Run fn(index, worker) for every index in [0, count)
+    void parallelFor(size_t count, const function<void(size_t, unsigned)>& fn) {
+        lock_guard<mutex> run(runMutex);
+        {
+            lock_guard<mutex> lock(stateMutex);
+            job = &fn;
+            jobSize = count;
+            nextIndex = 0;
+            busyWorkers = workers.size();
+            generation++;
+        }
+        wake.notify_all();
+        drain(0);
+        
+        unique_lock<mutex> lock(stateMutex);
+        finished.wait(lock, [&] { return busyWorkers == 0; });
+        job = nullptr;
+    }
+    
+    // Process-wide pool sized to the hardware
+    static ThreadPool& shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+};
+
+// Indexed min-heap of node IDs with an Arity-way branching factor. Each
+// node appears at most once and its slot is tracked in `position`, so a
+// shorter distance lowers the existing key instead of adding a duplicate.
+template <unsigned Arity = 4>
+class IndexedDaryHeap {
+private:
+    static constexpr uint32_t ABSENT = UINT32_MAX;
+    
+    vector<pair<int, uint32_t>> heap;  // (key, node)
+    vector<uint32_t> position;         // slot in heap, or ABSENT
+    
+    void place(uint32_t slot, const pair<int, uint32_t>& entry) {
+        heap[slot] = entry;
+        position[entry.second] = slot;
+    }
+    
+    void siftUp(uint32_t slot) {
+        pair<int, uint32_t> entry = heap[slot];
+        while (slot > 0) {
+            uint32_t parent = (slot - 1) / Arity;
+            if (heap[parent].first <= entry.first) break;
+            place(slot, heap[parent]);
+            slot = parent;
+        }
+        place(slot, entry);
+    }
+    
+    void siftDown(uint32_t slot) {
+        pair<int, uint32_t> entry = heap[slot];
+        uint32_t size = heap.size();
+        while (true) {
+            uint32_t first = slot * Arity + 1;
+            if (first >= size) break;
+            
+            uint32_t best = first;
+            uint32_t last = min(first + Arity, size);
+            for (uint32_t child = first + 1; child < last; child++) {
+                if (heap[child].first < heap[best].first) best = child;
+            }
+            if (heap[best].first >= entry.first) break;
+            place(slot, heap[best]);
+            slot = best;
+        }
+        place(slot, entry);
+    }
+    
+public:
+    // Allow node IDs in [0, nodeCount); returns true if storage grew
+    bool resize(uint32_t nodeCount) {
+        if (position.size() >= nodeCount) return false;
+        position.resize(nodeCount, ABSENT);
+        heap.reserve(nodeCount);
+        return true;
+    }
+    
+    bool empty() const {
+        return heap.empty();
+    }
+    
+    size_t size() const {
+        return heap.size();
+    }
+    
+    bool contains(uint32_t node) const {
+        return position[node] != ABSENT;
+    }
+    
+    const pair<int, uint32_t>& top() const {
+        return heap.front();
+    }
+    
+    // Insert node, or lower its key if it is already queued with a larger one
+    void pushOrDecrease(uint32_t node, int key) {
+        uint32_t slot = position[node];
+        if (slot == ABSENT) {
+            heap.push_back({key, node});
+            position[node] = heap.size() - 1;
+            siftUp(heap.size() - 1);
+        } else if (key < heap[slot].first) {
+            heap[slot].first = key;
+            siftUp(slot);
+        }
+    }
+    
+    void pop() {
+        position[heap.front().second] = ABSENT;
+        pair<int, uint32_t> last = heap.back();
+        heap.pop_back();
+        if (!heap.empty()) {
+            place(0, last);
+            siftDown(0);
+        }
+    }
+    
+    // Empty the heap in O(size) without touching the whole position array
+    void clear() {
+        for (const auto& entry : heap) position[entry.second] = ABSENT;
+        heap.clear();
+    }
+};
+
+// Per-thread search state reused across route queries. Entries are only
+// valid where their stamp matches the current query, so starting a query
+// is O(1) rather than a clear of arrays sized to the whole graph.
+class QueryWorkspace {
+private:
+    struct Side {
+        vector<int> distances;
+        vector<uint32_t> previous;
+        vector<uint32_t> via;      // search-specific tag, e.g. a CH middle node
+        vector<uint32_t> stamps;
+        IndexedDaryHeap<4> heap;
+    };
+    
+    Side sides[2];
+    uint32_t stamp = 0;
+    
+    // Buffer growth events across all workspaces; flat in steady state
+    static inline atomic<uint64_t> growthCount{0};
+    
+    template <typename T>
+    static void reserveFor(vector<T>& data, size_t size) {
+        if (data.capacity() < size) {
+            growthCount++;
+            data.reserve(max(size, data.capacity() * 2));
+        }
+    }
+    
+public:
+    vector<uint32_t> path;     // scratch ID path
+    vector<uint32_t> scratch;  // scratch stack for callers
+    
+    // Start a new query over a graph of nodeCount nodes
+    void begin(uint32_t nodeCount) {
+        for (Side& side : sides) {
+            if (side.stamps.size() < nodeCount) {
+                growthCount += 4;
+                side.distances.resize(nodeCount);
+                side.previous.resize(nodeCount);
+                side.via.resize(nodeCount);
+                side.stamps.resize(nodeCount, 0);
+            }
+            side.heap.clear();
+            if (side.heap.resize(nodeCount)) {
+                growthCount += 2;
+            }
+        }
+        if (++stamp == 0) {
+            for (Side& side : sides) fill(side.stamps.begin(), side.stamps.end(), 0);
+            stamp = 1;
+        }
+        path.clear();
+        scratch.clear();
+    }
+    
+    bool reached(int side, uint32_t v) const {
+        return sides[side].stamps[v] == stamp;
+    }
+    
+    int distance(int side, uint32_t v) const {
+        return reached(side, v) ? sides[side].distances[v] : INT_MAX;
+    }
+    
+    uint32_t previous(int side, uint32_t v) const {
+        return sides[side].previous[v];
+    }
+    
+    uint32_t via(int side, uint32_t v) const {
+        return sides[side].via[v];
+    }
+    
+    // Record a tentative distance for v
+    void label(int side, uint32_t v, int dist, uint32_t prev, uint32_t tag = CityInterner::INVALID_ID) {
+        Side& s = sides[side];
+        s.stamps[v] = stamp;
+        s.distances[v] = dist;
+        s.previous[v] = prev;
+        s.via[v] = tag;
+    }
+    
+    // Queue v with the given key, lowering it if v is already queued
+    void push(int side, int key, uint32_t v) {
+        sides[side].heap.pushOrDecrease(v, key);
+    }
+    
+    bool empty(int side) const {
+        return sides[side].heap.empty();
+    }
+    
+    size_t queueSize(int side) const {
+        return sides[side].heap.size();
+    }
+    
+    const pair<int, uint32_t>& top(int side) const {
+        return sides[side].heap.top();
+    }
+    
+    void pop(int side) {
+        sides[side].heap.pop();
+    }
+    
+    void clearQueue(int side) {
+        sides[side].heap.clear();
+    }
+    
+    // Walk parent links from v back to the start of one search side
+    void appendChain(int side, uint32_t v, vector<uint32_t>& out) const {
+        for (; v != CityInterner::INVALID_ID; v = previous(side, v)) {
+            append(out, v);
+        }
+    }
+    
+    // Append to a scratch vector, counting any reallocation
+    static void append(vector<uint32_t>& data, uint32_t value) {
+        reserveFor(data, data.size() + 1);
+        data.push_back(value);
+    }
+    
+    static uint64_t allocations() {
+        return growthCount.load();
+    }
+    
+    // Workspace owned by the calling thread
+    static QueryWorkspace& local() {
+        thread_local QueryWorkspace workspace;
+        return workspace;
+    }
+};
+
+// Non-owning CSR arrays, e.g. pointing into a memory-mapped file; has
+// the same member names as CSRGraph so searches can take either
+struct CSRView {
+    const uint32_t* offsets;
+    const uint32_t* targets;
+    const int* weights;
+    uint32_t nodes;
+    
+    uint32_t nodeCount() const {
+        return nodes;
+    }
+};
+
+// Dijkstra from src until dst is settled over a CSRGraph or CSRView;
+// fills path with node IDs and returns the distance, or -1
+template <typename Graph>
+int dijkstraSearch(const Graph& graph, uint32_t src, uint32_t dst, vector<uint32_t>& path,
+                   SearchStats& stats, QueryWorkspace& ws) {
+    ws.begin(graph.nodeCount());
+    ws.label(0, src, 0, CityInterner::INVALID_ID);
+    ws.push(0, 0, src);
+    
+    while (!ws.empty(0)) {
+        int currentDist = ws.top(0).first;
+        uint32_t current = ws.top(0).second;
+        ws.pop(0);
+        
+        if (currentDist > ws.distance(0, current)) continue;
+        stats.settledNodes++;
+        
+        if (current == dst) break;
+        
+        for (uint32_t e = graph.offsets[current]; e < graph.offsets[current + 1]; e++) {
+            uint32_t next = graph.targets[e];
+            int newDist = currentDist + graph.weights[e];
+            
+            if (newDist < ws.distance(0, next)) {
+                ws.label(0, next, newDist, current);
+                ws.push(0, newDist, next);
+            }
+        }
+    }
+    
+    if (!ws.reached(0, dst)) {
+        return -1;
+    }
+    ws.appendChain(0, dst, path);
+    reverse(path.begin(), path.end());
+    return ws.distance(0, dst);
+}
+
+// Multi-source Dijkstra over a CSRGraph or CSRView that settles nodes in
+// order of distance and hands each to visit(node, distance, origin), where
+// origin is the nearest source. Stops once the next node lies beyond
+// maxDistance or visit returns false; returns the number of nodes visited.
+template <typename Graph, typename Visitor>
+size_t boundedSearch(const Graph& graph, const vector<uint32_t>& sources, int maxDistance,
+                     QueryWorkspace& ws, Visitor visit) {
+    ws.begin(graph.nodeCount());
+    for (uint32_t src : sources) {
+        if (src < graph.nodeCount() && !ws.reached(0, src)) {
+            ws.label(0, src, 0, CityInterner::INVALID_ID, src);
+            ws.push(0, 0, src);
+        }
+    }
+    
+    size_t visited = 0;
+    while (!ws.empty(0)) {
+        int currentDist = ws.top(0).first;
+        uint32_t current = ws.top(0).second;
+        ws.pop(0);
+        
+        if (currentDist > ws.distance(0, current)) continue;
+        if (currentDist > maxDistance) break;
+        visited++;
+        if (!visit(current, currentDist, ws.via(0, current))) break;
+        
+        for (uint32_t e = graph.offsets[current]; e < graph.offsets[current + 1]; e++) {
+            uint32_t next = graph.targets[e];
+            int newDist = currentDist + graph.weights[e];
+            
+            if (newDist <= maxDistance && newDist < ws.distance(0, next)) {
+                ws.label(0, next, newDist, current, ws.via(0, current));
+                ws.push(0, newDist, next);
+            }
+        }
+    }
+    return visited;
+}
+
+// Length-prefixed vectors for the preprocessing files
+template <typename T>
+void writeVector(ostream& out, const vector<T>& data) {
+    uint64_t size = data.size();
+    out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.write(reinterpret_cast<const char*>(data.data()), size * sizeof(T));
+}
+
+template <typename T>
+bool readVector(istream& in, vector<T>& data) {
+    uint64_t size = 0;
+    if (!in.read(reinterpret_cast<char*>(&size), sizeof(size))) return false;
+    // Reject counts larger than what is left of the stream before allocating
+    streampos at = in.tellg();
+    if (at < 0 || !in.seekg(0, ios::end)) return false;
+    uint64_t left = static_cast<uint64_t>(in.tellg() - at);
+    in.seekg(at);
+    if (size > left / sizeof(T)) return false;
+    data.resize(size);
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(data.data()), size * sizeof(T)));
+}
+
+// Contraction Hierarchy over a frozen CSR graph. Nodes are contracted in
+// order of increasing importance; each contraction adds shortcut edges
+// between its remaining neighbours unless a witness path makes them
+// redundant. Queries then only ever move "upward" to more important nodes.
+class ContractionHierarchy {
+private:
+    struct Arc {
+        uint32_t to;
+        int weight;
+        uint32_t middle;  // contracted node a shortcut bypasses, or INVALID_ID
+    };
+    
+    static constexpr uint32_t FILE_MAGIC = 0x48435054; // "TPCH"
+    static constexpr uint32_t FILE_VERSION = 1;
+    
+    uint64_t sourceFingerprint = 0;
+    vector<uint32_t> rank;     // contraction order position of each node
+    CSRGraph upward;           // edges from each node to higher-ranked nodes
+    vector<uint32_t> middles;  // parallel to upward.targets
+    uint32_t shortcutCount = 0;
+    
+    // Scratch state for the bounded witness searches during contraction
+    struct WitnessSearch {
+        vector<int> distances;
+        vector<uint8_t> hops;      // edges on the path to each touched node
+        vector<uint32_t> touched;
+        vector<pair<int, uint32_t>> heap;
+        vector<int> laterMax;
+        vector<uint32_t> targetStamp;  // == stamp for nodes the search must reach
+        uint32_t stamp = 0;
+        int pendingTargets = 0;
+        
+        void reset() {
+            for (uint32_t v : touched) distances[v] = INT_MAX;
+            touched.clear();
+        }
+    };
+    
+    // Insert or shorten the arc to `to`; false if an equal or shorter exists
+    static bool setArc(vector<Arc>& arcs, uint32_t to, int weight, uint32_t middle) {
+        for (auto& arc : arcs) {
+            if (arc.to == to) {
+                if (weight >= arc.weight) return false;
+                arc.weight = weight;
+                arc.middle = middle;
+                return true;
+            }
+        }
+        arcs.push_back({to, weight, middle});
+        return true;
+    }
+    
+    // Dijkstra from start over the uncontracted graph, skipping `avoid` and
+    // stopping once every target is settled or beyond maxDistance,
+    // settleLimit settled nodes or hopLimit edges. A witness missed by these
+    // bounds only costs an extra shortcut.
+    static void witnessSearch(const vector<vector<Arc>>& graph, uint32_t start, uint32_t avoid,
+                              int maxDistance, WitnessSearch& ws) {
+        const int settleLimit = 200;
+        const uint8_t hopLimit = 5;
+        auto later = greater<pair<int, uint32_t>>();
+        ws.reset();
+        ws.heap.clear();
+        ws.distances[start] = 0;
+        ws.hops[start] = 0;
+        ws.touched.push_back(start);
+        ws.heap.push_back({0, start});
+        
+        int settled = 0;
+        while (!ws.heap.empty() && settled < settleLimit) {
+            pop_heap(ws.heap.begin(), ws.heap.end(), later);
+            int currentDist = ws.heap.back().first;
+            uint32_t current = ws.heap.back().second;
+            ws.heap.pop_back();
+            
+            if (currentDist > ws.distances[current]) continue;
+            if (currentDist > maxDistance) break;
+            settled++;
+            if (ws.targetStamp[current] == ws.stamp && --ws.pendingTargets == 0) break;
+            if (ws.hops[current] >= hopLimit) continue;
+            
+            for (const auto& arc : graph[current]) {
+                if (arc.to == avoid) continue;
+                int newDist = currentDist + arc.weight;
+                if (newDist < ws.distances[arc.to]) {
+                    if (ws.distances[arc.to] == INT_MAX) ws.touched.push_back(arc.to);
+                    ws.distances[arc.to] = newDist;
+                    ws.hops[arc.to] = ws.hops[current] + 1;
+                    ws.heap.push_back({newDist, arc.to});
+                    push_heap(ws.heap.begin(), ws.heap.end(), later);
+                }
+            }
+        }
+    }
+    
+    // Shortcuts needed to contract v; appended to `out` when non-null
+    static int findShortcuts(const vector<vector<Arc>>& graph, uint32_t v, WitnessSearch& ws,
+                             vector<pair<pair<uint32_t, uint32_t>, int>>* out) {
+        const vector<Arc>& arcs = graph[v];
+        // laterMax[i]: longest arc after i, bounding the search from arc i
+        vector<int>& laterMax = ws.laterMax;
+        laterMax.assign(arcs.size(), 0);
+        for (size_t i = arcs.size(); i-- > 1;) {
+            laterMax[i - 1] = max(laterMax[i], arcs[i].weight);
+        }
+        
+        int count = 0;
+        for (size_t i = 0; i + 1 < arcs.size(); i++) {
+            ws.stamp++;
+            ws.pendingTargets = static_cast<int>(arcs.size() - i - 1);
+            for (size_t j = i + 1; j < arcs.size(); j++) ws.targetStamp[arcs[j].to] = ws.stamp;
+            witnessSearch(graph, arcs[i].to, v, arcs[i].weight + laterMax[i], ws);
+            for (size_t j = i + 1; j < arcs.size(); j++) {
+                int via = arcs[i].weight + arcs[j].weight;
+                if (ws.distances[arcs[j].to] > via) {
+                    count++;
+                    if (out) out->push_back({{arcs[i].to, arcs[j].to}, via});
+                }
+            }
+        }
+        return count;
+    }
+    
+    // Structural checks on loaded arrays: ranks form a permutation, offsets
+    // are monotonic, every edge goes upward and every shortcut's middle node
+    // ranks below its tail, so queries and unpacking stay in range and end
+    bool consistent() const {
+        size_t n = rank.size();
+        size_t edgeCount = upward.targets.size();
+        if (upward.offsets.size() != n + 1 || upward.weights.size() != edgeCount ||
+            middles.size() != edgeCount || upward.offsets.front() != 0 || upward.offsets.back() != edgeCount) {
+            return false;
+        }
+        vector<bool> seen(n, false);
+        for (uint32_t r : rank) {
+            if (r >= n || seen[r]) return false;
+            seen[r] = true;
+        }
+        for (size_t u = 0; u < n; u++) {
+            if (upward.offsets[u] > upward.offsets[u + 1]) return false;
+            for (uint32_t e = upward.offsets[u]; e < upward.offsets[u + 1]; e++) {
+                uint32_t to = upward.targets[e], middle = middles[e];
+                if (to >= n || rank[to] <= rank[u] || upward.weights[e] < 0) return false;
+                if (middle != CityInterner::INVALID_ID && (middle >= n || rank[middle] >= rank[u])) return false;
+            }
+        }
+        return true;
+    }
+    
+    uint32_t middleOf(uint32_t low, uint32_t high) const {
+        for (uint32_t e = upward.offsets[low]; e < upward.offsets[low + 1]; e++) {
+            if (upward.targets[e] == high) return middles[e];
+        }
+        return CityInterner::INVALID_ID;
+    }
+    
+    // Expand the edge (from, to) into original edges, appending every node
+    // after `from` to path; stack holds pending (from, to, middle) triples
+    void unpackEdge(uint32_t from, uint32_t to, uint32_t middle, vector<uint32_t>& path,
+                    vector<uint32_t>& stack) const {
+        size_t base = stack.size();
+        QueryWorkspace::append(stack, from);
+        QueryWorkspace::append(stack, to);
+        QueryWorkspace::append(stack, middle);
+        
+        while (stack.size() > base) {
+            uint32_t segMiddle = stack.back(); stack.pop_back();
+            uint32_t segTo = stack.back(); stack.pop_back();
+            uint32_t segFrom = stack.back(); stack.pop_back();
+            if (segMiddle == CityInterner::INVALID_ID) {
+                QueryWorkspace::append(path, segTo);
+                continue;
+            }
+            // The middle node was contracted before both endpoints, so both
+            // halves are stored as upward edges of the middle node
+            QueryWorkspace::append(stack, segMiddle);
+            QueryWorkspace::append(stack, segTo);
+            QueryWorkspace::append(stack, middleOf(segMiddle, segTo));
+            QueryWorkspace::append(stack, segFrom);
+            QueryWorkspace::append(stack, segMiddle);
+            QueryWorkspace::append(stack, middleOf(segMiddle, segFrom));
+        }
+    }
+    
+    // Contract every node of graph, in the given order or, without one, by
+    // lazily updated importance
+    void contract(const CSRGraph& graph, uint64_t fingerprint, const vector<uint32_t>* fixedOrder) {
+        uint32_t n = graph.nodeCount();
+        sourceFingerprint = fingerprint;
+        shortcutCount = 0;
+        
+        // Dynamic adjacency without self loops or parallel edges
+        vector<vector<Arc>> remaining(n);
+        for (uint32_t u = 0; u < n; u++) {
+            for (uint32_t e = graph.offsets[u]; e < graph.offsets[u + 1]; e++) {
+                if (graph.targets[e] != u) {
+                    setArc(remaining[u], graph.targets[e], graph.weights[e], CityInterner::INVALID_ID);
+                }
+            }
+        }
+        
+        WitnessSearch ws;
+        ws.distances.assign(n, INT_MAX);
+        ws.hops.assign(n, 0);
+        ws.targetStamp.assign(n, 0);
+        vector<int> contractedNeighbors(n, 0);
+        vector<pair<pair<uint32_t, uint32_t>, int>> shortcuts;
+        auto priority = [&](uint32_t v) {
+            shortcuts.clear();
+            int added = findShortcuts(remaining, v, ws, &shortcuts);
+            return 2 * (added - static_cast<int>(remaining[v].size())) + contractedNeighbors[v];
+        };
+        
+        rank.assign(n, 0);
+        vector<RouteEdge> upwardEdges;
+        vector<uint32_t> upwardMiddles;
+        uint32_t nextRank = 0;
+        
+        // Rank v and replace it by the shortcuts just computed for it
+        auto contractNode = [&](uint32_t v) {
+            rank[v] = nextRank++;
+            
+            for (const auto& arc : remaining[v]) {
+                upwardEdges.push_back({v, arc.to, arc.weight});
+                upwardMiddles.push_back(arc.middle);
+                contractedNeighbors[arc.to]++;
+                
+                auto& neighborArcs = remaining[arc.to];
+                for (size_t i = 0; i < neighborArcs.size(); i++) {
+                    if (neighborArcs[i].to == v) {
+                        neighborArcs[i] = neighborArcs.back();
+                        neighborArcs.pop_back();
+                        break;
+                    }
+                }
+            }
+            for (const auto& shortcut : shortcuts) {
+                uint32_t a = shortcut.first.first;
+                uint32_t b = shortcut.first.second;
+                if (setArc(remaining[a], b, shortcut.second, v)) {
+                    setArc(remaining[b], a, shortcut.second, v);
+                    shortcutCount++;
+                }
+            }
+            remaining[v].clear();
+            remaining[v].shrink_to_fit();
+        };
+        
+        if (fixedOrder) {
+            for (uint32_t v : *fixedOrder) {
+                shortcuts.clear();
+                findShortcuts(remaining, v, ws, &shortcuts);
+                contractNode(v);
+            }
+        } else {
+            priority_queue<pair<int, uint32_t>, vector<pair<int, uint32_t>>, greater<pair<int, uint32_t>>> order;
+            for (uint32_t v = 0; v < n; v++) {
+                order.push({priority(v), v});
+            }
+            while (!order.empty()) {
+                uint32_t v = order.top().second;
+                order.pop();
+                
+                // Lazy update: re-queue if v is no longer the least important;
+                // otherwise contract it with the shortcuts just computed
+                int current = priority(v);
+                if (!order.empty() && current > order.top().first) {
+                    order.push({current, v});
+                    continue;
+                }
+                contractNode(v);
+            }
+        }
+        
+        // Pack the upward edges into CSR, carrying the middle node along
+        upward.build(n, upwardEdges);
+        middles.resize(upwardEdges.size());
+        vector<uint32_t> cursor(upward.offsets.begin(), upward.offsets.end() - 1);
+        for (size_t i = 0; i < upwardEdges.size(); i++) {
+            middles[cursor[upwardEdges[i].from]++] = upwardMiddles[i];
+        }
+    }
+    
+public:
+    // Contract every node of graph; fingerprint identifies the source graph
+    void build(const CSRGraph& graph, uint64_t fingerprint) {
+        contract(graph, fingerprint, nullptr);
+    }
+    
+    // Re-contract after routes changed, keeping previous's node order
+    // (nodes it has not seen go last). Any order gives exact queries, and
+    // reusing one skips the importance updates that dominate build().
+    void rebuild(const CSRGraph& graph, uint64_t fingerprint, const ContractionHierarchy& previous) {
+        uint32_t n = graph.nodeCount();
+        vector<uint32_t> order(n);
+        for (uint32_t v = 0; v < n; v++) order[v] = v;
+        auto known = [&](uint32_t v) { return v < previous.rank.size(); };
+        stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            if (known(a) != known(b)) return known(a);
+            return known(a) && previous.rank[a] < previous.rank[b];
+        });
+        contract(graph, fingerprint, &order);
+    }
+    
+    bool matches(uint64_t fingerprint) const {
+        return !rank.empty() && fingerprint == sourceFingerprint;
+    }
+    
+    uint32_t shortcuts() const {
+        return shortcutCount;
+    }
+    
+    uint32_t nodeCount() const {
+        return rank.size();
+    }
+    
+    // Bidirectional upward search; fills the unpacked node path. Nodes
+    // added after the hierarchy was built are unreachable (-1).
+    int query(uint32_t src, uint32_t dst, vector<uint32_t>& path, SearchStats& stats,
+              QueryWorkspace& ws) const {
+        if (src >= nodeCount() || dst >= nodeCount()) return -1;
+        ws.begin(upward.nodeCount());
+        ws.label(0, src, 0, CityInterner::INVALID_ID);
+        ws.label(1, dst, 0, CityInterner::INVALID_ID);
+        ws.push(0, 0, src);
+        ws.push(1, 0, dst);
+        
+        int best = INT_MAX;
+        uint32_t meeting = CityInterner::INVALID_ID;
+        
+        for (int side = 0; !ws.empty(0) || !ws.empty(1); side = 1 - side) {
+            if (ws.empty(side)) continue;
+            int currentDist = ws.top(side).first;
+            uint32_t current = ws.top(side).second;
+            
+            // Each side may stop once it cannot beat the best meeting
+            if (currentDist >= best) {
+                ws.clearQueue(side);
+                continue;
+            }
+            ws.pop(side);
+            
+            if (currentDist > ws.distance(side, current)) continue;
+            stats.settledNodes++;
+            
+            int other = ws.distance(1 - side, current);
+            if (other != INT_MAX && currentDist + other < best) {
+                best = currentDist + other;
+                meeting = current;
+            }
+            
+            for (uint32_t e = upward.offsets[current]; e < upward.offsets[current + 1]; e++) {
+                uint32_t next = upward.targets[e];
+                int newDist = currentDist + upward.weights[e];
+                if (newDist < ws.distance(side, next)) {
+                    ws.label(side, next, newDist, current, middles[e]);
+                    ws.push(side, newDist, next);
+                }
+            }
+        }
+        
+        if (meeting == CityInterner::INVALID_ID) {
+            return -1;
+        }
+        
+        // Upward chain src..meeting (collected backwards in scratch), then
+        // the downward chain meeting..dst
+        path.clear();
+        vector<uint32_t>& stack = ws.scratch;
+        stack.clear();
+        for (uint32_t v = meeting; v != src; v = ws.previous(0, v)) {
+            QueryWorkspace::append(stack, v);
+        }
+        size_t upCount = stack.size();
+        
+        QueryWorkspace::append(path, src);
+        uint32_t at = src;
+        for (size_t i = upCount; i-- > 0;) {
+            uint32_t v = stack[i];
+            unpackEdge(at, v, ws.via(0, v), path, stack);
+            at = v;
+        }
+        stack.clear();
+        for (uint32_t v = meeting; v != dst; v = ws.previous(1, v)) {
+            unpackEdge(v, ws.previous(1, v), ws.via(1, v), path, stack);
+        }
+        return best;
+    }
+    
+    bool save(const string& filename) const {
+        ofstream out(filename, ios::binary);
+        if (!out.is_open()) return false;
+        
+        out.write(reinterpret_cast<const char*>(&FILE_MAGIC), sizeof(FILE_MAGIC));
+        out.write(reinterpret_cast<const char*>(&FILE_VERSION), sizeof(FILE_VERSION));
+        out.write(reinterpret_cast<const char*>(&sourceFingerprint), sizeof(sourceFingerprint));
+        out.write(reinterpret_cast<const char*>(&shortcutCount), sizeof(shortcutCount));
+        writeVector(out, rank);
+        writeVector(out, upward.offsets);
+        writeVector(out, upward.targets);
+        writeVector(out, upward.weights);
+        writeVector(out, middles);
+        return static_cast<bool>(out);
+    }
+    
+    bool load(const string& filename) {
+        ifstream in(filename, ios::binary);
+        uint32_t magic = 0, version = 0;
+        if (!in.read(reinterpret_cast<char*>(&magic), sizeof(magic)) || magic != FILE_MAGIC) return false;
+        if (!in.read(reinterpret_cast<char*>(&version), sizeof(version)) || version != FILE_VERSION) return false;
+        
+        ContractionHierarchy loaded;
+        in.read(reinterpret_cast<char*>(&loaded.sourceFingerprint), sizeof(loaded.sourceFingerprint));
+        in.read(reinterpret_cast<char*>(&loaded.shortcutCount), sizeof(loaded.shortcutCount));
+        if (!readVector(in, loaded.rank) || !readVector(in, loaded.upward.offsets) ||
+            !readVector(in, loaded.upward.targets) || !readVector(in, loaded.upward.weights) ||
+            !readVector(in, loaded.middles)) {
+            return false;
+        }
+        
+        if (!loaded.consistent()) return false;
+        *this = move(loaded);
+        return true;
+    }
+};
+
+// ALT (A*, landmarks, triangle inequality) lower bounds. Each landmark
+// stores its distance to every city; routes are undirected, so
+// |d(L, t) - d(L, v)| never exceeds the distance from v to t, with no
+// coordinates needed. Rows are stored node-major, so the values for one
+// city share a cache line and new cities simply append.
+class LandmarkTable {
+private:
+    static constexpr uint32_t FILE_MAGIC = 0x544c5054; // "TPLT"
+    static constexpr uint32_t FILE_VERSION = 1;
+    static constexpr int UNREACHABLE = INT_MAX;
+    
+    uint64_t sourceFingerprint = 0;
+    vector<uint32_t> landmarkIds;
+    vector<int> distances;  // distances[v * count() + l]
+    
+    // Farthest-point selection by hop count: each landmark is the city the
+    // most hops away from those chosen so far. Cities no landmark reaches
+    // count as farthest, so each component gets one; isolated cities are
+    // never chosen.
+    static vector<uint32_t> selectLandmarks(const CSRGraph& graph, uint32_t count) {
+        uint32_t n = graph.nodeCount();
+        vector<uint32_t> hops(n, UINT32_MAX), nearest(n, UINT32_MAX), queue;
+        queue.reserve(n);
+        auto farthest = [&](const vector<uint32_t>& from) {
+            uint32_t best = UINT32_MAX;
+            for (uint32_t v = 0; v < n; v++) {
+                if (graph.offsets[v] == graph.offsets[v + 1] || from[v] == 0) continue;
+                if (best == UINT32_MAX || from[v] > from[best]) best = v;
+            }
+            return best;
+        };
+        auto bfs = [&](uint32_t root) {
+            fill(hops.begin(), hops.end(), UINT32_MAX);
+            queue.assign(1, root);
+            hops[root] = 0;
+            for (size_t head = 0; head < queue.size(); head++) {
+                uint32_t u = queue[head];
+                for (uint32_t e = graph.offsets[u]; e < graph.offsets[u + 1]; e++) {
+                    if (hops[graph.targets[e]] == UINT32_MAX) {
+                        hops[graph.targets[e]] = hops[u] + 1;
+                        queue.push_back(graph.targets[e]);
+                    }
+                }
+            }
+        };
+        
+        // Start from the far end of the graph as seen from its first
+        // connected city rather than from a central city
+        vector<uint32_t> chosen;
+        uint32_t next = farthest(nearest);
+        if (next == UINT32_MAX) return chosen;
+        bfs(next);
+        next = farthest(hops);
+        while (next != UINT32_MAX && chosen.size() < count) {
+            chosen.push_back(next);
+            bfs(next);
+            for (uint32_t v = 0; v < n; v++) nearest[v] = min(nearest[v], hops[v]);
+            next = farthest(nearest);
+        }
+        return chosen;
+    }
+    
+public:
+    static constexpr uint32_t DEFAULT_LANDMARKS = 8;
+    static constexpr uint32_t ACTIVE_LANDMARKS = 4;
+    
+    // Estimate of the remaining distance to one target, using the
+    // landmarks that bound the whole query best
+    class Goal {
+    private:
+        const LandmarkTable* table;
+        uint32_t target;
+        uint32_t active[ACTIVE_LANDMARKS];
+        uint32_t activeCount = 0;
+        
+    public:
+        Goal(const LandmarkTable& landmarks, uint32_t source, uint32_t target)
+            : table(&landmarks), target(target) {
+            while (activeCount < ACTIVE_LANDMARKS) {
+                int bestBound = 0;
+                uint32_t best = UINT32_MAX;
+                for (uint32_t l = 0; l < landmarks.count(); l++) {
+                    int bound = landmarks.bound(source, target, l);
+                    if (bound > bestBound && find(active, active + activeCount, l) == active + activeCount) {
+                        bestBound = bound;
+                        best = l;
+                    }
+                }
+                if (best == UINT32_MAX) break;
+                active[activeCount++] = best;
+            }
+        }
+        
+        int operator()(uint32_t v) const {
+            int best = 0;
+            for (uint32_t i = 0; i < activeCount; i++) {
+                best = max(best, table->bound(v, target, active[i]));
+            }
+            return best;
+        }
+    };
+    
+    // Pick count landmarks and run one full search from each, spread
+    // over the shared thread pool
+    void build(const CSRGraph& graph, uint32_t count = DEFAULT_LANDMARKS) {
+        uint32_t n = graph.nodeCount();
+        landmarkIds = selectLandmarks(graph, count);
+        uint32_t k = landmarkIds.size();
+        vector<vector<int>> rows(k);
+        ThreadPool::shared().parallelFor(k, [&](size_t l, unsigned) {
+            rows[l].assign(n, UNREACHABLE);
+            vector<int>& row = rows[l];
+            boundedSearch(graph, vector<uint32_t>{landmarkIds[l]}, INT_MAX, QueryWorkspace::local(),
+                          [&row](uint32_t node, int distance, uint32_t) {
+                row[node] = distance;
+                return true;
+            });
+        });
+        distances.resize(static_cast<size_t>(n) * k);
+        for (uint32_t v = 0; v < n; v++) {
+            for (uint32_t l = 0; l < k; l++) {
+                distances[static_cast<size_t>(v) * k + l] = rows[l][v];
+            }
+        }
+        sourceFingerprint = 0;
+    }
+    
+    // Routes out of a and b got shorter or were added. Lowering values
+    // until d(L, y) <= d(L, x) + w(x, y) holds on every edge again keeps
+    // each row a valid, consistent bound; longer or removed routes never
+    // break that, so they need no repair (the bounds just loosen).
+    void repair(const CSRGraph& graph, uint32_t a, uint32_t b) {
+        uint32_t n = graph.nodeCount();
+        uint32_t k = count();
+        distances.resize(static_cast<size_t>(n) * k, UNREACHABLE);
+        vector<pair<int, uint32_t>> heap;
+        auto at = [&](uint32_t v, uint32_t l) -> int& { return distances[static_cast<size_t>(v) * k + l]; };
+        for (uint32_t l = 0; l < k; l++) {
+            for (uint32_t seed : {a, b}) {
+                if (at(seed, l) != UNREACHABLE) heap.push_back({-at(seed, l), seed});
+            }
+            make_heap(heap.begin(), heap.end());
+            while (!heap.empty()) {
+                pop_heap(heap.begin(), heap.end());
+                int distance = -heap.back().first;
+                uint32_t u = heap.back().second;
+                heap.pop_back();
+                if (distance > at(u, l)) continue;
+                for (uint32_t e = graph.offsets[u]; e < graph.offsets[u + 1]; e++) {
+                    int through = distance + graph.weights[e];
+                    if (through < at(graph.targets[e], l)) {
+                        at(graph.targets[e], l) = through;
+                        heap.push_back({-through, graph.targets[e]});
+                        push_heap(heap.begin(), heap.end());
+                    }
+                }
+            }
+        }
+    }
+    
+    uint32_t count() const {
+        return landmarkIds.size();
+    }
+    
+    uint32_t landmark(uint32_t l) const {
+        return landmarkIds[l];
+    }
+    
+    size_t bytes() const {
+        return distances.size() * sizeof(int) + landmarkIds.size() * sizeof(uint32_t);
+    }
+    
+    // Lower bound on the distance from v to t given by landmark l
+    int bound(uint32_t v, uint32_t t, uint32_t l) const {
+        size_t k = landmarkIds.size();
+        if ((static_cast<size_t>(max(v, t)) + 1) * k > distances.size()) return 0;
+        int dv = distances[v * k + l], dt = distances[t * k + l];
+        if (dv == UNREACHABLE || dt == UNREACHABLE) return 0;
+        return dv > dt ? dv - dt : dt - dv;
+    }
+    
+    bool matches(uint64_t fingerprint) const {
+        return !landmarkIds.empty() && fingerprint == sourceFingerprint;
+    }
+    
+    // fingerprint identifies the graph the table is saved for
+    bool save(const string& filename, uint64_t fingerprint) const {
+        ofstream out(filename, ios::binary);
+        if (!out.is_open()) return false;
+        
+        out.write(reinterpret_cast<const char*>(&FILE_MAGIC), sizeof(FILE_MAGIC));
+        out.write(reinterpret_cast<const char*>(&FILE_VERSION), sizeof(FILE_VERSION));
+        out.write(reinterpret_cast<const char*>(&fingerprint), sizeof(fingerprint));
+        writeVector(out, landmarkIds);
+        writeVector(out, distances);
+        return static_cast<bool>(out);
+    }
+    
+    bool load(const string& filename) {
+        ifstream in(filename, ios::binary);
+        uint32_t magic = 0, version = 0;
+        if (!in.read(reinterpret_cast<char*>(&magic), sizeof(magic)) || magic != FILE_MAGIC) return false;
+        if (!in.read(reinterpret_cast<char*>(&version), sizeof(version)) || version != FILE_VERSION) return false;
+        
+        LandmarkTable loaded;
+        in.read(reinterpret_cast<char*>(&loaded.sourceFingerprint), sizeof(loaded.sourceFingerprint));
+        if (!readVector(in, loaded.landmarkIds) || !readVector(in, loaded.distances)) {
+            return false;
+        }
+        if (loaded.landmarkIds.empty() || loaded.distances.size() % loaded.landmarkIds.size() != 0) {
+            return false;
+        }
+        *this = move(loaded);
+        return true;
+    }
+};
+
+// Hit/miss counters of a RouteCache, summed over its shards
+struct RouteCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;      // live entries pushed out by capacity
+    uint64_t invalidations = 0;  // entries dropped because the graph changed
+    size_t entries = 0;
+    
+    double hitRate() const {
+        uint64_t lookups = hits + misses;
+        return lookups ? static_cast<double>(hits) / lookups : 0.0;
+    }
+};
+
+// Sharded LRU cache of (source, destination) -> (distance, path) for
+// RouteGraph. Routes are undirected, so a pair and its reverse share one
+// entry; paths are stored from the lower to the higher city ID and
+// reversed on the way out. Every entry carries the graph version it was
+// computed against and is dropped on the first lookup after the graph
+// changes. Each shard is a fixed array of slots on an intrusive LRU list
+// guarded by its own mutex, so evicting reuses the slot's path buffer.
+class RouteCache {
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+    
+    struct Slot {
+        uint64_t key = 0;
+        uint64_t version = 0;
+        int distance = -1;
+        vector<uint32_t> path;
+        uint32_t prev = NONE;
+        uint32_t next = NONE;
+        bool live = false;
+    };
+    
+    struct Shard {
+        mutex lock;
+        vector<Slot> slots;
+        unordered_map<uint64_t, uint32_t> index;
+        uint32_t head = NONE;  // most recently used
+        uint32_t tail = NONE;  // least recently used
+        uint32_t capacity = 0;
+        uint64_t hits = 0, misses = 0, evictions = 0, invalidations = 0;
+        
+        void unlink(uint32_t s) {
+            Slot& slot = slots[s];
+            (slot.prev == NONE ? head : slots[slot.prev].next) = slot.next;
+            (slot.next == NONE ? tail : slots[slot.next].prev) = slot.prev;
+            slot.prev = slot.next = NONE;
+        }
+        
+        void pushFront(uint32_t s) {
+            slots[s].next = head;
+            if (head != NONE) slots[head].prev = s;
+            head = s;
+            if (tail == NONE) tail = s;
+        }
+        
+        void erase(uint32_t s) {
+            index.erase(slots[s].key);
+            slots[s].live = false;
+            unlink(s);
+            // Park the slot at the tail so the next insert reuses it
+            slots[s].prev = tail;
+            if (tail != NONE) slots[tail].next = s;
+            tail = s;
+            if (head == NONE) head = s;
+        }
+    };
+    
+    vector<unique_ptr<Shard>> shards;
+    
+    static uint64_t pairKey(uint32_t src, uint32_t dst) {
+        return static_cast<uint64_t>(min(src, dst)) << 32 | max(src, dst);
+    }
+    
+    Shard& shardFor(uint64_t key) {
+        // Fibonacci hashing spreads neighbouring IDs across shards
+        return *shards[(key * 0x9E3779B97F4A7C15ULL >> 32) % shards.size()];
+    }
+    
+public:
+    // Version numbers come from one process-wide counter, so graphs copied
+    // from a common ancestor never reuse a version after they diverge
+    static uint64_t newVersion() {
+        static atomic<uint64_t> counter{0};
+        return ++counter;
+    }
+    
+    explicit RouteCache(size_t capacity = 4096, unsigned shardCount = 16) {
+        shardCount = max(1u, shardCount);
+        uint32_t perShard = max<size_t>(1, (capacity + shardCount - 1) / shardCount);
+        for (unsigned i = 0; i < shardCount; i++) {
+            shards.push_back(make_unique<Shard>());
+            shards.back()->capacity = perShard;
+        }
+    }
+    
+    // Copy the cached route for the pair into path; false on a miss
+    bool lookup(uint32_t src, uint32_t dst, uint64_t version, int& distance, vector<uint32_t>& path) {
+        uint64_t key = pairKey(src, dst);
+        Shard& shard = shardFor(key);
+        lock_guard<mutex> guard(shard.lock);
+        
+        auto it = shard.index.find(key);
+        if (it == shard.index.end()) {
+            shard.misses++;
+            return false;
+        }
+        uint32_t s = it->second;
+        if (shard.slots[s].version != version) {
+            shard.erase(s);
+            shard.invalidations++;
+            shard.misses++;
+            return false;
+        }
+        
+        shard.unlink(s);
+        shard.pushFront(s);
+        shard.hits++;
+        
+        const Slot& slot = shard.slots[s];
+        distance = slot.distance;
+        if (src <= dst) {
+            path.assign(slot.path.begin(), slot.path.end());
+        } else {
+            path.assign(slot.path.rbegin(), slot.path.rend());
+        }
+        return true;
+    }
+    
+    // Remember the route found for the pair, evicting the least recently
+    // used entry of the shard when it is full
+    void store(uint32_t src, uint32_t dst, uint64_t version, int distance, const vector<uint32_t>& path) {
+        uint64_t key = pairKey(src, dst);
+        Shard& shard = shardFor(key);
+        lock_guard<mutex> guard(shard.lock);
+        
+        uint32_t s;
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            s = it->second;
+            shard.unlink(s);
+        } else if (shard.slots.size() < shard.capacity) {
+            s = shard.slots.size();
+            shard.slots.emplace_back();
+            shard.index.emplace(key, s);
+        } else {
+            s = shard.tail;
+            if (shard.slots[s].live) {
+                shard.index.erase(shard.slots[s].key);
+                shard.evictions++;
+            }
+            shard.unlink(s);
+            shard.index.emplace(key, s);
+        }
+        
+        Slot& slot = shard.slots[s];
+        slot.key = key;
+        slot.live = true;
+        slot.version = version;
+        slot.distance = distance;
+        if (src <= dst) {
+            slot.path.assign(path.begin(), path.end());
+        } else {
+            slot.path.assign(path.rbegin(), path.rend());
+        }
+        shard.pushFront(s);
+    }
+    
+    // Entries computed against fromVersion that keep(src, dst, distance,
+    // path) accepts move to toVersion; the others are dropped and counted
+    // as invalidations. Paths are passed from the lower to the higher ID.
+    template <typename Keep>
+    void revalidate(uint64_t fromVersion, uint64_t toVersion, Keep keep) {
+        for (auto& shard : shards) {
+            lock_guard<mutex> guard(shard->lock);
+            for (uint32_t s = 0; s < shard->slots.size(); s++) {
+                Slot& slot = shard->slots[s];
+                if (!slot.live || slot.version != fromVersion) continue;
+                if (keep(static_cast<uint32_t>(slot.key >> 32), static_cast<uint32_t>(slot.key), slot.distance, slot.path)) {
+                    slot.version = toVersion;
+                } else {
+                    shard->erase(s);
+                    shard->invalidations++;
+                }
+            }
+        }
+    }
+    
+    // Independent copy with the same entries and counters
+    shared_ptr<RouteCache> clone() const {
+        auto copy = make_shared<RouteCache>(1, shards.size());
+        for (size_t i = 0; i < shards.size(); i++) {
+            lock_guard<mutex> guard(shards[i]->lock);
+            Shard& target = *copy->shards[i];
+            const Shard& source = *shards[i];
+            target.slots = source.slots;
+            target.index = source.index;
+            target.head = source.head;
+            target.tail = source.tail;
+            target.capacity = source.capacity;
+            target.hits = source.hits;
+            target.misses = source.misses;
+            target.evictions = source.evictions;
+            target.invalidations = source.invalidations;
+        }
+        return copy;
+    }
+    
+    // Drop every entry; counters are kept
+    void clear() {
+        for (auto& shard : shards) {
+            lock_guard<mutex> guard(shard->lock);
+            shard->slots.clear();
+            shard->index.clear();
+            shard->head = shard->tail = NONE;
+        }
+    }
+    
+    RouteCacheStats stats() const {
+        RouteCacheStats total;
+        for (const auto& shard : shards) {
+            lock_guard<mutex> guard(shard->lock);
+            total.hits += shard->hits;
+            total.misses += shard->misses;
+            total.evictions += shard->evictions;
+            total.invalidations += shard->invalidations;
+            total.entries += shard->index.size();
+        }
+        return total;
+    }
+};
+
+// Criteria for RouteGraph::paretoRoutes, combined as a bitmask
+enum RouteCriterion : unsigned {
+    ByDistance = 1,
+    ByPrice = 2,
+    ByDuration = 4,
+    ByLegs = 8
+};
+
+// A route with its totals and the mode of every leg
+struct RoutePlan {
+    int distance = 0;
+    int price = 0;
+    int duration = 0;
+    uint32_t legs = 0;
+    vector<string> path;
+    vector<TravelMode> modes;  // modes[i] joins path[i] and path[i + 1]
+    
+    void display() const {
+        cout << distance << " km, $" << price << ", " << duration / 60 << "h" << setw(2) << setfill('0')
+             << duration % 60 << setfill(' ') << ", " << legs << (legs == 1 ? " leg" : " legs") << ": ";
+        for (size_t i = 0; i < path.size(); i++) {
+            if (i > 0) cout << " -(" << RouteAttributes::modeName(modes[i - 1]) << ")-> ";
+            cout << path[i];
+        }
+        cout << "\n";
+    }
+};
+
+// Scratch state for multi-criteria searches, one per thread like
+// QueryWorkspace. Labels live in one pool; every node keeps a bag of the
+// indices of its non-dominated labels.
+class ParetoWorkspace {
+public:
+    static constexpr int CRITERIA = 4;  // distance, price, duration, legs
+    
+    struct Label {
+        int value[CRITERIA];
+        uint32_t node;
+        uint32_t parent;  // label index, or INVALID_ID at the source
+        uint32_t slot;    // CSR slot of the leg that reached node
+        bool dead;        // dominated after it was queued
+    };
+    
+    vector<Label> labels;
+    vector<vector<uint32_t>> bags;
+    vector<uint32_t> touched;                    // nodes with a non-empty bag
+    vector<pair<long long, uint32_t>> queue;     // (key, label) min-heap
+    vector<int> bounds[CRITERIA];                // lower bounds to the target
+    
+    void begin(uint32_t nodeCount) {
+        for (uint32_t v : touched) bags[v].clear();
+        touched.clear();
+        if (bags.size() < nodeCount) bags.resize(nodeCount);
+        labels.clear();
+        queue.clear();
+    }
+    
+    static ParetoWorkspace& local() {
+        thread_local ParetoWorkspace workspace;
+        return workspace;
+    }
+};
+
+// Scratch state for k-shortest path searches, one per thread: exact
+// distances to the target, used as A* bounds by every spur search, and a
+// stamped set of nodes the current spur search must avoid
+class DetourWorkspace {
+private:
+    vector<uint32_t> blockedStamps;
+    uint32_t stamp = 0;
+    
+public:
+    vector<int> toTarget;
+    vector<uint32_t> blockedNext;  // neighbours the spur node must not step to
+    
+    // Forget every blocked node
+    void unblockAll(uint32_t nodeCount) {
+        if (blockedStamps.size() < nodeCount) blockedStamps.resize(nodeCount, 0);
+        if (++stamp == 0) {
+            fill(blockedStamps.begin(), blockedStamps.end(), 0);
+            stamp = 1;
+        }
+        blockedNext.clear();
+    }
+    
+    void block(uint32_t v) {
+        blockedStamps[v] = stamp;
+    }
+    
+    bool blocked(uint32_t v) const {
+        return blockedStamps[v] == stamp;
+    }
+    
+    static DetourWorkspace& local() {
+        thread_local DetourWorkspace workspace;
+        return workspace;
+    }
+};
+
+// Graph class for route planning over interned city IDs
+class RouteGraph {
+private:
+    static constexpr uint32_t NO_ROUTE = UINT32_MAX;
+    
+    // City names and the route index are shared by copies until one of
+    // them adds or removes a city or route, so copying a graph to publish
+    // it only copies the flat edge and CSR arrays
+    shared_ptr<CityInterner> cities = make_shared<CityInterner>();
+    vector<RouteEdge> edges;             // route r is edges 2r and 2r + 1
+    vector<RouteAttributes> attributes;  // parallel to edges
+    // Route per mode for each city pair (lower ID in the high half); one
+    // route per pair and mode, so re-adding one updates it
+    typedef unordered_map<uint64_t, array<uint32_t, 4>> RouteIndex;
+    shared_ptr<RouteIndex> routeIndex = make_shared<RouteIndex>();
+    vector<double> latitudes;   // NaN when a city has no coordinates
+    vector<double> longitudes;
+    // Smallest route km / great-circle km ratio, refreshed with the CSR;
+    // 0 once a route joins a located city to one without coordinates
+    mutable double routeBound = 1.0;
+    mutable bool boundStale = false;
+    
+    // CSR view of edges, rebuilt lazily after addRoute, with the
+    // attributes of each CSR slot. Const queries may do that rebuild, so
+    // only a frozen graph is safe to query from several threads.
+    mutable CSRGraph csr;
+    mutable vector<RouteAttributes> slotAttributes;
+    mutable vector<uint32_t> edgeSlots;  // CSR slot of each edge
+    mutable bool frozen = true;
+    
+    // Optional preprocessing; shared so copies of the graph can reuse it.
+    // A stale hierarchy no longer matches the routes: Hierarchy queries
+    // fall back to bidirectional search, and it only serves as the node
+    // order for refreshContractionHierarchy's full re-contraction.
+    shared_ptr<const ContractionHierarchy> hierarchy;
+    bool hierarchyStale = false;
+    
+    // Optional ALT bounds, shared by copies until a route change repairs
+    // this graph's own copy
+    shared_ptr<LandmarkTable> landmarks;
+    
+    // Optional result cache, shared by copies; entries are tagged with
+    // versionNumber, which changes whenever the routes do
+    shared_ptr<RouteCache> cache;
+    uint64_t versionNumber = RouteCache::newVersion();
+    
+    void ensureFrozen() const {
+        if (!frozen) {
+            vector<uint32_t> slotEdges;
+            csr.build(cities->size(), edges, &slotEdges);
+            slotAttributes.resize(slotEdges.size());
+            edgeSlots.resize(slotEdges.size());
+            for (uint32_t slot = 0; slot < slotEdges.size(); slot++) {
+                slotAttributes[slot] = attributes[slotEdges[slot]];
+                edgeSlots[slotEdges[slot]] = slot;
+            }
+            frozen = true;
+        }
+        if (boundStale) {
+            routeBound = measureRouteBound();
+            boundStale = false;
+        }
+    }
+    
+    // Ratio of one route's km to the great-circle distance between its
+    // ends. A path's km is at least the smallest ratio of its legs times
+    // the great-circle distance between its ends.
+    double routeRatio(uint32_t a, uint32_t b, int distance) const {
+        if (hasLocation(a) != hasLocation(b)) return 0;
+        if (!hasLocation(a)) return 1.0;
+        double km = greatCircleKm(latitudes[a], longitudes[a], latitudes[b], longitudes[b]);
+        return km > 0 ? distance / km : 1.0;
+    }
+    
+    double measureRouteBound() const {
+        double bound = 1.0;
+        for (size_t e = 0; e < edges.size(); e += 2) {
+            bound = min(bound, routeRatio(edges[e].from, edges[e].to, edges[e].distance));
+        }
+        return bound;
+    }
+    
+    // A new or changed route can only lower the bound; longer or removed
+    // routes leave it conservative until coordinates change
+    void noteRoute(uint32_t a, uint32_t b, int distance) {
+        routeBound = min(routeBound, routeRatio(a, b, distance));
+    }
+    
+    // Id of a city, adding it to a private copy of the shared name table
+    // if it is new
+    uint32_t internCity(const string& name) {
+        uint32_t id = cities->find(name);
+        if (id != CityInterner::INVALID_ID) return id;
+        if (cities.use_count() > 1) cities = make_shared<CityInterner>(*cities);
+        return cities->intern(name);
+    }
+    
+    RouteIndex& ownRouteIndex() {
+        if (routeIndex.use_count() > 1) routeIndex = make_shared<RouteIndex>(*routeIndex);
+        return *routeIndex;
+    }
+    
+    static uint64_t pairKey(uint32_t a, uint32_t b) {
+        return static_cast<uint64_t>(min(a, b)) << 32 | max(a, b);
+    }
+    
+    uint32_t findRoute(uint32_t a, uint32_t b, TravelMode mode) const {
+        auto it = routeIndex->find(pairKey(a, b));
+        return it == routeIndex->end() ? NO_ROUTE : it->second[static_cast<uint8_t>(mode)];
+    }
+    
+    uint32_t appendRoute(uint32_t a, uint32_t b, const RouteAttributes& route) {
+        uint32_t r = edges.size() / 2;
+        edges.push_back({a, b, route.distance});
+        edges.push_back({b, a, route.distance}); // Undirected graph
+        attributes.push_back(route);
+        attributes.push_back(route);
+        noteRoute(a, b, route.distance);
+        auto inserted = ownRouteIndex().try_emplace(pairKey(a, b));
+        if (inserted.second) inserted.first->second.fill(NO_ROUTE);
+        inserted.first->second[static_cast<uint8_t>(route.mode)] = r;
+        frozen = false;
+        return r;
+    }
+    
+    // Overwrite route r in place; a frozen CSR is patched, not rebuilt
+    void setRoute(uint32_t r, const RouteAttributes& route) {
+        for (uint32_t e = 2 * r; e < 2 * r + 2; e++) {
+            edges[e].distance = route.distance;
+            attributes[e] = route;
+            if (frozen) {
+                csr.weights[edgeSlots[e]] = route.distance;
+                slotAttributes[edgeSlots[e]] = route;
+            }
+        }
+        noteRoute(edges[2 * r].from, edges[2 * r].to, route.distance);
+    }
+    
+    // The routes are about to change: mark preprocessing stale and give
+    // this graph a private cache, so copies sharing it are unaffected
+    void beginChange() {
+        hierarchyStale = hierarchy != nullptr;
+        if (cache && cache.use_count() > 1) {
+            cache = cache->clone();
+        }
+    }
+    
+    // Carry cached routes over to the next version after the distance of
+    // the leg a-b went from oldDistance to newDistance (-1: no leg). Longer
+    // or removed legs only invalidate routes through a and b; a shorter or
+    // new leg invalidates routes it can now beat, found with one search
+    // from each end.
+    void repairCache(uint32_t a, uint32_t b, int oldDistance, int newDistance) {
+        uint64_t previous = versionNumber;
+        versionNumber = RouteCache::newVersion();
+        if (!cache) return;
+        
+        if (newDistance >= 0 && (oldDistance < 0 || newDistance < oldDistance)) {
+            ensureFrozen();
+            vector<int> fromA, fromB;
+            lowerBounds(a, 0, fromA);
+            lowerBounds(b, 0, fromB);
+            cache->revalidate(previous, versionNumber, [&](uint32_t s, uint32_t t, int distance, const vector<uint32_t>&) {
+                auto via = [&](const vector<int>& first, const vector<int>& second) {
+                    if (first[s] == INT_MAX || second[t] == INT_MAX) return LLONG_MAX;
+                    return static_cast<long long>(first[s]) + newDistance + second[t];
+                };
+                long long best = min(via(fromA, fromB), via(fromB, fromA));
+                return distance >= 0 ? best >= distance : best == LLONG_MAX;
+            });
+        } else if (newDistance != oldDistance) {
+            cache->revalidate(previous, versionNumber, [&](uint32_t, uint32_t, int, const vector<uint32_t>& path) {
+                for (size_t i = 0; i + 1 < path.size(); i++) {
+                    if ((path[i] == a && path[i + 1] == b) || (path[i] == b && path[i + 1] == a)) return false;
+                }
+                return true;
+            });
+        } else {
+            cache->revalidate(previous, versionNumber, [](uint32_t, uint32_t, int, const vector<uint32_t>&) {
+                return true;
+            });
+        }
+    }
+    
+    bool hasLocation(uint32_t id) const {
+        return id < latitudes.size() && !std::isnan(latitudes[id]);
+    }
+    
+    // A* estimate of the remaining distance from u to target, scaled by
+    // the shortest route seen relative to its great-circle distance so it
+    // stays admissible on imported or hand-entered catalogs
+    int heuristic(uint32_t u, uint32_t target) const {
+        if (!hasLocation(u) || !hasLocation(target)) {
+            return 0;
+        }
+        double km = greatCircleKm(latitudes[u], longitudes[u], latitudes[target], longitudes[target]);
+        return static_cast<int>(km * min(heuristicScale, routeBound));
+    }
+    
+    // Value of one leg under a criterion; legs count 1 each
+    int legValue(uint32_t slot, int criterion) const {
+        const RouteAttributes& leg = slotAttributes[slot];
+        switch (criterion) {
+            case 0: return leg.distance;
+            case 1: return leg.price;
+            case 2: return leg.duration;
+            default: return 1;
+        }
+    }
+    
+    // Exact single-criterion distances from every node to target (INT_MAX
+    // when unreachable); routes are undirected, so one search from target
+    void lowerBounds(uint32_t target, int criterion, vector<int>& bounds) const {
+        QueryWorkspace& ws = QueryWorkspace::local();
+        ws.begin(csr.nodeCount());
+        ws.label(0, target, 0, CityInterner::INVALID_ID);
+        ws.push(0, 0, target);
+        while (!ws.empty(0)) {
+            int currentDist = ws.top(0).first;
+            uint32_t current = ws.top(0).second;
+            ws.pop(0);
+            if (currentDist > ws.distance(0, current)) continue;
+            for (uint32_t e = csr.offsets[current]; e < csr.offsets[current + 1]; e++) {
+                uint32_t next = csr.targets[e];
+                int newDist = currentDist + legValue(e, criterion);
+                if (newDist < ws.distance(0, next)) {
+                    ws.label(0, next, newDist, current);
+                    ws.push(0, newDist, next);
+                }
+            }
+        }
+        bounds.resize(csr.nodeCount());
+        for (uint32_t v = 0; v < csr.nodeCount(); v++) {
+            bounds[v] = ws.distance(0, v);
+        }
+    }
+    
+    // Shortest distance of the leg u -> v, taking the shortest parallel
+    // route; INT_MAX if they are not adjacent
+    int legDistance(uint32_t u, uint32_t v) const {
+        int best = INT_MAX;
+        for (uint32_t e = csr.offsets[u]; e < csr.offsets[u + 1]; e++) {
+            if (csr.targets[e] == v) best = min(best, csr.weights[e]);
+        }
+        return best;
+    }
+    
+    // A* from spur (already rootDist from the source) to dst, avoiding the
+    // workspace's blocked nodes and, from spur itself, its blocked next
+    // hops. Gives up once no path can come in under bound. Appends the
+    // spur-to-dst nodes after the root and returns the total, or -1.
+    int spurSearch(uint32_t spur, uint32_t dst, int rootDist, long long bound, const DetourWorkspace& dw,
+                   vector<uint32_t>& path, SearchStats& stats, QueryWorkspace& ws) const {
+        ws.begin(csr.nodeCount());
+        ws.label(0, spur, rootDist, CityInterner::INVALID_ID);
+        ws.push(0, rootDist + dw.toTarget[spur], spur);
+        
+        while (!ws.empty(0)) {
+            if (ws.top(0).first >= bound) break;
+            uint32_t current = ws.top(0).second;
+            int currentDist = ws.top(0).first - dw.toTarget[current];
+            ws.pop(0);
+            
+            if (currentDist > ws.distance(0, current)) continue;
+            stats.settledNodes++;
+            if (current == dst) break;
+            
+            for (uint32_t e = csr.offsets[current]; e < csr.offsets[current + 1]; e++) {
+                uint32_t next = csr.targets[e];
+                if (dw.blocked(next) || dw.toTarget[next] == INT_MAX) continue;
+                if (current == spur && find(dw.blockedNext.begin(), dw.blockedNext.end(), next) != dw.blockedNext.end()) {
+                    continue;
+                }
+                int newDist = currentDist + csr.weights[e];
+                if (newDist < ws.distance(0, next)) {
+                    ws.label(0, next, newDist, current);
+                    ws.push(0, newDist + dw.toTarget[next], next);
+                }
+            }
+        }
+        
+        if (!ws.reached(0, dst) || ws.distance(0, dst) >= bound) {
+            return -1;
+        }
+        size_t rootEnd = path.size();
+        ws.appendChain(0, dst, path);
+        reverse(path.begin() + rootEnd, path.end());
+        return ws.distance(0, dst);
+    }
+    
+    int dijkstra(uint32_t src, uint32_t dst, vector<uint32_t>& path, SearchStats& stats,
+                 QueryWorkspace& ws) const {
+        return dijkstraSearch(csr, src, dst, path, stats, ws);
+    }
+    
+    // Alternates between the two frontiers, always expanding the smaller
+    // queue, and stops once the frontiers cannot improve the best meeting
+    int bidirectional(uint32_t src, uint32_t dst, vector<uint32_t>& path, SearchStats& stats,
+                      QueryWorkspace& ws) const {
+        ws.begin(csr.nodeCount());
+        ws.label(0, src, 0, CityInterner::INVALID_ID);
+        ws.label(1, dst, 0, CityInterner::INVALID_ID);
+        ws.push(0, 0, src);
+        ws.push(1, 0, dst);
+        
+        int best = INT_MAX;
+        uint32_t meeting = src == dst ? src : CityInterner::INVALID_ID;
+        if (src == dst) best = 0;
+        
+        while (!ws.empty(0) && !ws.empty(1)) {
+            if (static_cast<long long>(ws.top(0).first) + ws.top(1).first >= best) break;
+            
+            int side = ws.queueSize(0) <= ws.queueSize(1) ? 0 : 1;
+            int currentDist = ws.top(side).first;
+            uint32_t current = ws.top(side).second;
+            ws.pop(side);
+            
+            if (currentDist > ws.distance(side, current)) continue;
+            stats.settledNodes++;
+            
+            for (uint32_t e = csr.offsets[current]; e < csr.offsets[current + 1]; e++) {
+                uint32_t next = csr.targets[e];
+                int newDist = currentDist + csr.weights[e];
+                
+                if (newDist < ws.distance(side, next)) {
+                    ws.label(side, next, newDist, current);
+                    ws.push(side, newDist, next);
+                }
+                
+                int other = ws.distance(1 - side, next);
+                if (other != INT_MAX && ws.distance(side, next) + other < best) {
+                    best = ws.distance(side, next) + other;
+                    meeting = next;
+                }
+            }
+        }
+        
+        if (meeting == CityInterner::INVALID_ID) {
+            return -1;
+        }
+        ws.appendChain(0, meeting, path);
+        reverse(path.begin(), path.end());
+        ws.appendChain(1, ws.previous(1, meeting), path);
+        return best;
+    }
+    
+    // A* with estimate(v) bounding the distance from v to dst. Nodes may be
+    // re-expanded when a mixed coordinate/no-coordinate graph makes the
+    // great-circle heuristic inconsistent, so results stay exact.
+    template <typename Estimate>
+    int aStar(uint32_t src, uint32_t dst, vector<uint32_t>& path, SearchStats& stats,
+              QueryWorkspace& ws, const Estimate& estimate) const {
+        ws.begin(csr.nodeCount());
+        ws.label(0, src, 0, CityInterner::INVALID_ID);
+        ws.push(0, estimate(src), src);
+        
+        while (!ws.empty(0)) {
+            uint32_t current = ws.top(0).second;
+            int currentDist = ws.top(0).first - estimate(current);
+            ws.pop(0);
+            
+            if (currentDist > ws.distance(0, current)) continue;
+            stats.settledNodes++;
+            
+            if (current == dst) break;
+            
+            for (uint32_t e = csr.offsets[current]; e < csr.offsets[current + 1]; e++) {
+                uint32_t next = csr.targets[e];
+                int newDist = currentDist + csr.weights[e];
+                
+                if (newDist < ws.distance(0, next)) {
+                    ws.label(0, next, newDist, current);
+                    ws.push(0, newDist + estimate(next), next);
+                }
+            }
+        }
+        
+        if (!ws.reached(0, dst)) {
+            return -1;
+        }
+        ws.appendChain(0, dst, path);
+        reverse(path.begin(), path.end());
+        return ws.distance(0, dst);
+    }
+    
+public:
+    // Route distances are rounded travel distances and can undercut the
+    // great-circle value slightly, so A* scales its estimate down; it is
+    // lowered further if some route is shorter than that
+    double heuristicScale = 0.95;
+    
+    // Add an edge between two cities with distance
+    void addRoute(const string& city1, const string& city2, int distance) {
+        addRoute(city1, city2, RouteAttributes::byRoad(distance));
+    }
+    
+    // Add an edge with its price, duration and mode; cities may be joined
+    // by one route per mode, e.g. one by rail and one by air, and adding
+    // an existing pair and mode replaces that route. Meant for bulk loads:
+    // cached routes and landmarks are simply dropped; see updateRoute.
+    void addRoute(const string& city1, const string& city2, const RouteAttributes& route) {
+        uint32_t a = internCity(city1);
+        uint32_t b = internCity(city2);
+        uint32_t r = findRoute(a, b, route.mode);
+        beginChange();
+        if (r == NO_ROUTE) {
+            appendRoute(a, b, route);
+        } else {
+            setRoute(r, route);
+        }
+        landmarks.reset();
+        versionNumber = RouteCache::newVersion();
+    }
+    
+    // Set the route joining two cities by route.mode, adding it if there
+    // is none; true if one was replaced. A weight change patches the
+    // frozen graph in place and keeps every cached route it cannot affect;
+    // landmark bounds are repaired in place, and a contraction hierarchy
+    // turns stale until refreshed.
+    bool updateRoute(const string& city1, const string& city2, const RouteAttributes& route) {
+        uint32_t a = internCity(city1);
+        uint32_t b = internCity(city2);
+        uint32_t r = findRoute(a, b, route.mode);
+        int oldDistance = r == NO_ROUTE ? -1 : edges[2 * r].distance;
+        
+        bool wasStale = hierarchyStale;
+        beginChange();
+        if (r == NO_ROUTE) {
+            appendRoute(a, b, route);
+        } else {
+            setRoute(r, route);
+            if (route.distance == oldDistance) {
+                hierarchyStale = wasStale; // price or duration only
+            }
+        }
+        repairCache(a, b, oldDistance, route.distance);
+        if (landmarks && (oldDistance < 0 || route.distance < oldDistance)) {
+            if (landmarks.use_count() > 1) {
+                landmarks = make_shared<LandmarkTable>(*landmarks);
+            }
+            ensureFrozen();
+            landmarks->repair(csr, a, b);
+        }
+        return r != NO_ROUTE;
+    }
+    
+    // Remove the route joining two cities by mode; false if there is none
+    bool removeRoute(const string& city1, const string& city2, TravelMode mode) {
+        uint32_t a = cities->find(city1);
+        uint32_t b = cities->find(city2);
+        if (a == CityInterner::INVALID_ID || b == CityInterner::INVALID_ID) return false;
+        uint32_t r = findRoute(a, b, mode);
+        if (r == NO_ROUTE) return false;
+        
+        // Move the last route into the gap
+        beginChange();
+        int oldDistance = edges[2 * r].distance;
+        RouteIndex& index = ownRouteIndex();
+        auto entry = index.find(pairKey(a, b));
+        entry->second[static_cast<uint8_t>(mode)] = NO_ROUTE;
+        if (all_of(entry->second.begin(), entry->second.end(), [](uint32_t id) { return id == NO_ROUTE; })) {
+            index.erase(entry);
+        }
+        uint32_t last = edges.size() / 2 - 1;
+        if (r != last) {
+            for (uint32_t k = 0; k < 2; k++) {
+                edges[2 * r + k] = edges[2 * last + k];
+                attributes[2 * r + k] = attributes[2 * last + k];
+            }
+            index[pairKey(edges[2 * r].from, edges[2 * r].to)][static_cast<uint8_t>(attributes[2 * r].mode)] = r;
+        }
+        edges.resize(2 * last);
+        attributes.resize(2 * last);
+        frozen = false;
+        
+        repairCache(a, b, oldDistance, -1);
+        return true;
+    }
+    
+    // Remove every route between two cities; returns how many were removed
+    size_t removeRoutes(const string& city1, const string& city2) {
+        const TravelMode modes[] = {TravelMode::Road, TravelMode::Rail, TravelMode::Air, TravelMode::Ferry};
+        size_t removed = 0;
+        for (TravelMode mode : modes) {
+            removed += removeRoute(city1, city2, mode);
+        }
+        return removed;
+    }
+    
+    // Current attributes of the route joining two cities by mode
+    bool findRoute(const string& city1, const string& city2, TravelMode mode, RouteAttributes& route) const {
+        uint32_t a = cities->find(city1);
+        uint32_t b = cities->find(city2);
+        if (a == CityInterner::INVALID_ID || b == CityInterner::INVALID_ID) return false;
+        uint32_t r = findRoute(a, b, mode);
+        if (r == NO_ROUTE) return false;
+        route = attributes[2 * r];
+        return true;
+    }
+    
+    size_t routeCount() const {
+        return edges.size() / 2;
+    }
+    
+    // Pre-size for a bulk load of the given number of cities and routes
+    void reserve(size_t cityCount, size_t routeCount) {
+        edges.reserve(edges.size() + 2 * routeCount);
+        attributes.reserve(attributes.size() + 2 * routeCount);
+        latitudes.reserve(cityCount);
+        longitudes.reserve(cityCount);
+    }
+    
+    // Attach coordinates to a city for A* searches
+    void setCityLocation(const string& city, double latitude, double longitude) {
+        uint32_t before = cities->size();
+        uint32_t id = internCity(city);
+        if (id < before) {
+            boundStale = true; // its routes' ratios change
+        } else {
+            beginChange(); // new node
+            versionNumber = RouteCache::newVersion();
+            frozen = false;
+        }
+        if (id >= latitudes.size()) {
+            latitudes.resize(id + 1, NAN);
+            longitudes.resize(id + 1, NAN);
+        }
+        // Coordinates only feed the A* heuristic, not the CSR arrays
+        latitudes[id] = latitude;
+        longitudes[id] = longitude;
+    }
+    
+    // Build the CSR arrays now instead of on the next query
+    void freeze() const {
+        ensureFrozen();
+    }
+    
+    // FNV-1a hash of the city names and CSR arrays, used to tie
+    // preprocessed data on disk to the graph it was built from
+    uint64_t fingerprint() const {
+        ensureFrozen();
+        uint64_t hash = 1469598103934665603ULL;
+        auto mix = [&hash](const void* data, size_t bytes) {
+            const unsigned char* p = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < bytes; i++) {
+                hash = (hash ^ p[i]) * 1099511628211ULL;
+            }
+        };
+        for (uint32_t id = 0; id < cities->size(); id++) {
+            mix(cities->name(id).data(), cities->name(id).size() + 1);
+        }
+        mix(csr.offsets.data(), csr.offsets.size() * sizeof(uint32_t));
+        mix(csr.targets.data(), csr.targets.size() * sizeof(uint32_t));
+        mix(csr.weights.data(), csr.weights.size() * sizeof(int));
+        return hash;
+    }
+    
+    // Contract the current graph for SearchMode::Hierarchy queries
+    void buildContractionHierarchy() {
+        uint64_t hash = fingerprint();
+        auto built = make_shared<ContractionHierarchy>();
+        built->build(csr, hash);
+        hierarchy = built;
+        hierarchyStale = false;
+    }
+    
+    // Choose landmarks and compute their distances for
+    // SearchMode::Landmarks queries, one landmark per pool thread
+    void buildLandmarks(uint32_t count = LandmarkTable::DEFAULT_LANDMARKS) {
+        ensureFrozen();
+        auto built = make_shared<LandmarkTable>();
+        built->build(csr, count);
+        landmarks = built;
+    }
+    
+    bool hasLandmarks() const {
+        return landmarks != nullptr;
+    }
+    
+    const LandmarkTable* landmarkTable() const {
+        return landmarks.get();
+    }
+    
+    bool saveLandmarks(const string& filename) const {
+        return landmarks && landmarks->count() > 0 && landmarks->save(filename, fingerprint());
+    }
+    
+    // Load landmarks from disk; rejected if saved for a different graph
+    bool loadLandmarks(const string& filename) {
+        auto loaded = make_shared<LandmarkTable>();
+        if (!loaded->load(filename) || !loaded->matches(fingerprint())) {
+            return false;
+        }
+        landmarks = loaded;
+        return true;
+    }
+    
+    // Bring a stale hierarchy up to date. This is a full re-contraction of
+    // every node, not a local repair; reusing the previous node order only
+    // skips the importance updates. False if there is no hierarchy or it
+    // is current.
+    bool refreshContractionHierarchy() {
+        if (!hierarchy || !hierarchyStale) return false;
+        uint64_t hash = fingerprint();
+        auto rebuilt = make_shared<ContractionHierarchy>();
+        rebuilt->rebuild(csr, hash, *hierarchy);
+        hierarchy = rebuilt;
+        hierarchyStale = false;
+        return true;
+    }
+    
+    bool hierarchyNeedsRefresh() const {
+        return hierarchy && hierarchyStale;
+    }
+    
+    // Cache shortest-path results in front of the searches
+    void enableRouteCache(size_t capacity = 4096, unsigned shards = 16) {
+        cache = make_shared<RouteCache>(capacity, shards);
+    }
+    
+    void disableRouteCache() {
+        cache.reset();
+    }
+    
+    RouteCacheStats routeCacheStats() const {
+        return cache ? cache->stats() : RouteCacheStats();
+    }
+    
+    // Changes whenever the routes do
+    uint64_t version() const {
+        return versionNumber;
+    }
+    
+    bool hasContractionHierarchy() const {
+        return hierarchy && !hierarchyStale && hierarchy->nodeCount() == cities->size();
+    }
+    
+    uint32_t hierarchyShortcuts() const {
+        return hierarchy ? hierarchy->shortcuts() : 0;
+    }
+    
+    bool saveContractionHierarchy(const string& filename) const {
+        return hasContractionHierarchy() && hierarchy->save(filename);
+    }
+    
+    // Load a hierarchy from disk; rejected if built from a different graph
+    bool loadContractionHierarchy(const string& filename) {
+        auto loaded = make_shared<ContractionHierarchy>();
+        if (!loaded->load(filename) || !loaded->matches(fingerprint())) {
+            return false;
+        }
+        hierarchy = loaded;
+        hierarchyStale = false;
+        return true;
+    }
+    
+    // Frozen CSR arrays, for code that walks the graph directly
+    const CSRGraph& adjacency() const {
+        ensureFrozen();
+        return csr;
+    }
+    
+    // Price, duration and mode of each CSR slot, parallel to adjacency().targets
+    const vector<RouteAttributes>& adjacencyRoutes() const {
+        ensureFrozen();
+        return slotAttributes;
+    }
+    
+    uint32_t cityId(const string& name) const {
+        return cities->find(name);
+    }
+    
+    const string& cityName(uint32_t id) const {
+        return cities->name(id);
+    }
+    
+    uint32_t cityCount() const {
+        return cities->size();
+    }
+    
+    // ID-level query using the calling thread's workspace; path is
+    // overwritten and, once its capacity has grown, nothing is allocated
+    int shortestPathIds(uint32_t src, uint32_t dst, vector<uint32_t>& path,
+                        SearchMode mode = SearchMode::Dijkstra, SearchStats* stats = nullptr) const {
+        path.clear();
+        if (src >= cities->size() || dst >= cities->size()) {
+            return -1;
+        }
+        
+        SearchStats localStats;
+        int distance;
+        if (cache && cache->lookup(src, dst, versionNumber, distance, path)) {
+            if (stats) {
+                *stats = localStats;
+            }
+            return distance;
+        }
+        
+        ensureFrozen();
+        QueryWorkspace& ws = QueryWorkspace::local();
+        
+        switch (mode) {
+            case SearchMode::Bidirectional:
+                distance = bidirectional(src, dst, path, localStats, ws);
+                break;
+            case SearchMode::AStar:
+                distance = aStar(src, dst, path, localStats, ws, [&](uint32_t v) { return heuristic(v, dst); });
+                break;
+            case SearchMode::Landmarks:
+                // Falls back to great-circle A* until preprocessed
+                if (landmarks) {
+                    distance = aStar(src, dst, path, localStats, ws, LandmarkTable::Goal(*landmarks, src, dst));
+                } else {
+                    distance = aStar(src, dst, path, localStats, ws, [&](uint32_t v) { return heuristic(v, dst); });
+                }
+                break;
+            case SearchMode::Hierarchy:
+                // Falls back to a bidirectional search until preprocessed
+                distance = hasContractionHierarchy() ? hierarchy->query(src, dst, path, localStats, ws)
+                                     : bidirectional(src, dst, path, localStats, ws);
+                break;
+            default:
+                distance = dijkstra(src, dst, path, localStats, ws);
+        }
+        
+        if (cache) {
+            cache->store(src, dst, versionNumber, distance, path);
+        }
+        if (stats) {
+            *stats = localStats;
+        }
+        return distance;
+    }
+    
+    // Find the shortest path between two cities with the chosen strategy
+    pair<int, vector<string>> findShortestPath(const string& source, const string& destination,
+                                               SearchMode mode = SearchMode::Dijkstra,
+                                               SearchStats* stats = nullptr) const {
+        vector<string> path;
+        uint32_t src = cities->find(source);
+        uint32_t dst = cities->find(destination);
+        
+        if (src == CityInterner::INVALID_ID || dst == CityInterner::INVALID_ID) {
+            return {-1, path}; // Unknown city
+        }
+        
+        vector<uint32_t>& idPath = QueryWorkspace::local().path;
+        int distance = shortestPathIds(src, dst, idPath, mode, stats);
+        if (distance == -1) {
+            return {-1, path}; // No path found
+        }
+        
+        path.reserve(idPath.size());
+        for (uint32_t id : idPath) {
+            path.push_back(cities->name(id));
+        }
+        return {distance, path};
+    }
+    
+    // Visit every city within maxDistance of any source as
+    // visit(id, distance, origin) in increasing distance, origin being the
+    // nearest source; return false from visit to stop early. Runs in the
+    // calling thread's workspace, so visit must not start another route
+    // query on the same thread.
+    template <typename Visitor>
+    size_t forEachWithinIds(const vector<uint32_t>& sources, int maxDistance, Visitor visit) const {
+        ensureFrozen();
+        return boundedSearch(csr, sources, maxDistance, QueryWorkspace::local(), visit);
+    }
+    
+    // Cities within maxDistance km of source, nearest first (source included
+    // at 0) as visit(name, distance); return false from visit to stop
+    template <typename Visitor>
+    void forEachWithin(const string& source, int maxDistance, Visitor visit) const {
+        uint32_t src = cities->find(source);
+        if (src == CityInterner::INVALID_ID) return;
+        forEachWithinIds(vector<uint32_t>{src}, maxDistance, [&](uint32_t id, int distance, uint32_t) {
+            return visit(cities->name(id), distance);
+        });
+    }
+    
+    // Multi-source variant: cities within maxDistance km of any source as
+    // visit(name, distance, nearestSource); unknown sources are ignored
+    template <typename Visitor>
+    void forEachWithinAny(const vector<string>& sources, int maxDistance, Visitor visit) const {
+        vector<uint32_t> ids;
+        for (const string& source : sources) {
+            uint32_t id = cities->find(source);
+            if (id != CityInterner::INVALID_ID) ids.push_back(id);
+        }
+        if (ids.empty()) return;
+        forEachWithinIds(ids, maxDistance, [&](uint32_t id, int distance, uint32_t origin) {
+            return visit(cities->name(id), distance, cities->name(origin));
+        });
+    }
+    
+    // Copying variant of forEachWithin, at most limit cities
+    vector<pair<string, int>> citiesWithin(const string& source, int maxDistance,
+                                           size_t limit = SIZE_MAX) const {
+        vector<pair<string, int>> result;
+        forEachWithin(source, maxDistance, [&](const string& name, int distance) {
+            if (result.size() >= limit) return false;
+            result.push_back({name, distance});
+            return true;
+        });
+        return result;
+    }
+    
+    // Up to k loopless routes from src to dst in order of distance (Yen's
+    // algorithm with Lawler's rule: a new path only spurs from where it
+    // left its parent). One search from dst gives exact remaining
+    // distances, so every spur search is an A* that heads straight for dst,
+    // and it gives up once it cannot beat the k-th best candidate so far.
+    // Routes are node sequences; parallel routes count once, by the shortest.
+    vector<pair<int, vector<uint32_t>>> kShortestPathIds(uint32_t src, uint32_t dst, size_t k,
+                                                         SearchStats* stats = nullptr) const {
+        struct Candidate {
+            vector<uint32_t> path;
+            size_t deviation;  // index of the spur node it branched at
+        };
+        vector<pair<int, vector<uint32_t>>> found;
+        SearchStats localStats;
+        if (src >= cities->size() || dst >= cities->size() || k == 0) {
+            return found;
+        }
+        
+        ensureFrozen();
+        DetourWorkspace& dw = DetourWorkspace::local();
+        QueryWorkspace& ws = QueryWorkspace::local();
+        lowerBounds(dst, 0, dw.toTarget);
+        if (dw.toTarget[src] == INT_MAX) {
+            return found;
+        }
+        
+        // With exact bounds the first search walks straight down to dst
+        vector<uint32_t> first;
+        dw.unblockAll(csr.nodeCount());
+        found.push_back({spurSearch(src, dst, 0, LLONG_MAX, dw, first, localStats, ws), first});
+        vector<size_t> deviations = {0};
+        
+        multimap<int, Candidate> candidates;
+        set<vector<uint32_t>> seen = {first};
+        vector<uint32_t> spurPath;
+        while (found.size() < k) {
+            const vector<uint32_t>& last = found.back().second;
+            size_t needed = k - found.size();
+            
+            int rootDist = 0;
+            for (size_t i = 0; i < deviations.back(); i++) {
+                rootDist += legDistance(last[i], last[i + 1]);
+            }
+            for (size_t i = deviations.back(); i + 1 < last.size(); i++) {
+                uint32_t spur = last[i];
+                dw.unblockAll(csr.nodeCount());
+                for (size_t j = 0; j < i; j++) dw.block(last[j]);
+                for (const auto& path : found) {
+                    const vector<uint32_t>& p = path.second;
+                    if (p.size() > i + 1 && equal(p.begin(), p.begin() + i + 1, last.begin())) {
+                        dw.blockedNext.push_back(p[i + 1]);
+                    }
+                }
+                
+                // Only candidates that could still make the top k matter
+                long long bound = LLONG_MAX;
+                if (candidates.size() >= needed) {
+                    bound = next(candidates.begin(), needed - 1)->first;
+                }
+                if (rootDist + static_cast<long long>(dw.toTarget[spur]) < bound) {
+                    spurPath.assign(last.begin(), last.begin() + i);
+                    int distance = spurSearch(spur, dst, rootDist, bound, dw, spurPath, localStats, ws);
+                    if (distance >= 0 && seen.insert(spurPath).second) {
+                        candidates.insert({distance, Candidate{spurPath, i}});
+                        if (candidates.size() > needed) candidates.erase(prev(candidates.end()));
+                    }
+                }
+                rootDist += legDistance(last[i], last[i + 1]);
+            }
+            
+            if (candidates.empty()) break;
+            found.push_back({candidates.begin()->first, move(candidates.begin()->second.path)});
+            deviations.push_back(candidates.begin()->second.deviation);
+            candidates.erase(candidates.begin());
+        }
+        
+        if (stats) {
+            *stats = localStats;
+        }
+        return found;
+    }
+    
+    // Up to k alternative routes between two cities, shortest first
+    vector<pair<int, vector<string>>> kShortestPaths(const string& source, const string& destination, size_t k,
+                                                     SearchStats* stats = nullptr) const {
+        vector<pair<int, vector<string>>> routes;
+        uint32_t src = cities->find(source);
+        uint32_t dst = cities->find(destination);
+        if (src == CityInterner::INVALID_ID || dst == CityInterner::INVALID_ID) {
+            return routes;
+        }
+        for (const auto& found : kShortestPathIds(src, dst, k, stats)) {
+            vector<string> path;
+            for (uint32_t id : found.second) path.push_back(cities->name(id));
+            routes.push_back({found.first, move(path)});
+        }
+        return routes;
+    }
+    
+    // Non-dominated routes between two cities under the chosen criteria,
+    // sorted by distance. Label-setting search: labels leave the queue in
+    // order of their summed values plus exact per-criterion lower bounds to
+    // the destination, so a settled label is never dominated later. A label
+    // is dropped when another label at its node, or a destination label
+    // compared against its lower bounds, is at least as good on every
+    // criterion. Bags hold at most maxLabelsPerNode labels; refusals are
+    // counted in SearchStats::droppedLabels, and when any occur the result
+    // may miss some trade-offs.
+    vector<RoutePlan> paretoRoutes(const string& source, const string& destination,
+                                   unsigned criteria = ByDistance | ByPrice | ByLegs,
+                                   uint32_t maxLabelsPerNode = 32, SearchStats* stats = nullptr) const {
+        const int CRITERIA = ParetoWorkspace::CRITERIA;
+        typedef ParetoWorkspace::Label Label;
+        vector<RoutePlan> routes;
+        SearchStats localStats;
+        uint32_t src = cities->find(source);
+        uint32_t dst = cities->find(destination);
+        criteria &= (1u << CRITERIA) - 1;
+        if (src == CityInterner::INVALID_ID || dst == CityInterner::INVALID_ID || criteria == 0) {
+            return routes;
+        }
+        
+        ensureFrozen();
+        ParetoWorkspace& pw = ParetoWorkspace::local();
+        bool selected[CRITERIA];
+        for (int c = 0; c < CRITERIA; c++) {
+            selected[c] = criteria & (1u << c);
+            if (selected[c]) lowerBounds(dst, c, pw.bounds[c]);
+        }
+        int first = 0;
+        while (!selected[first]) first++;
+        if (pw.bounds[first][src] == INT_MAX) {
+            return routes; // No path
+        }
+        pw.begin(csr.nodeCount());
+        
+        auto atMostOnSelected = [&](const int* a, const int* b) {
+            for (int c = 0; c < CRITERIA; c++) {
+                if (selected[c] && a[c] > b[c]) return false;
+            }
+            return true;
+        };
+        // Queue a new label unless it is dominated; evicts labels it dominates
+        auto offer = [&](const int* value, uint32_t node, uint32_t parent, uint32_t slot) {
+            long long key = 0;
+            int estimate[CRITERIA];
+            for (int c = 0; c < CRITERIA; c++) {
+                if (!selected[c]) continue;
+                estimate[c] = value[c] + pw.bounds[c][node];
+                key += estimate[c];
+            }
+            for (uint32_t t : pw.bags[dst]) {
+                if (atMostOnSelected(pw.labels[t].value, estimate)) return;
+            }
+            
+            vector<uint32_t>& bag = pw.bags[node];
+            for (uint32_t other : bag) {
+                if (atMostOnSelected(pw.labels[other].value, value)) return;
+            }
+            for (size_t i = 0; i < bag.size();) {
+                if (atMostOnSelected(value, pw.labels[bag[i]].value)) {
+                    pw.labels[bag[i]].dead = true;
+                    bag[i] = bag.back();
+                    bag.pop_back();
+                } else {
+                    i++;
+                }
+            }
+            if (bag.size() >= maxLabelsPerNode) {
+                localStats.droppedLabels++;
+                return;
+            }
+            if (bag.empty()) pw.touched.push_back(node);
+            
+            Label label;
+            copy(value, value + CRITERIA, label.value);
+            label.node = node;
+            label.parent = parent;
+            label.slot = slot;
+            label.dead = false;
+            bag.push_back(pw.labels.size());
+            pw.queue.push_back({key, static_cast<uint32_t>(pw.labels.size())});
+            push_heap(pw.queue.begin(), pw.queue.end(), greater<pair<long long, uint32_t>>());
+            pw.labels.push_back(label);
+        };
+        
+        const int zero[CRITERIA] = {0, 0, 0, 0};
+        offer(zero, src, CityInterner::INVALID_ID, 0);
+        while (!pw.queue.empty()) {
+            pop_heap(pw.queue.begin(), pw.queue.end(), greater<pair<long long, uint32_t>>());
+            uint32_t current = pw.queue.back().second;
+            pw.queue.pop_back();
+            if (pw.labels[current].dead) continue;
+            localStats.settledNodes++;
+            
+            uint32_t u = pw.labels[current].node;
+            if (u == dst) continue;
+            for (uint32_t e = csr.offsets[u]; e < csr.offsets[u + 1]; e++) {
+                uint32_t next = csr.targets[e];
+                if (pw.bounds[first][next] == INT_MAX) continue;
+                int value[CRITERIA];
+                for (int c = 0; c < CRITERIA; c++) {
+                    value[c] = pw.labels[current].value[c] + legValue(e, c);
+                }
+                offer(value, next, current, e);
+            }
+        }
+        
+        for (uint32_t t : pw.bags[dst]) {
+            const Label& label = pw.labels[t];
+            RoutePlan route;
+            route.distance = label.value[0];
+            route.price = label.value[1];
+            route.duration = label.value[2];
+            route.legs = label.value[3];
+            for (uint32_t at = t; at != CityInterner::INVALID_ID; at = pw.labels[at].parent) {
+                route.path.push_back(cities->name(pw.labels[at].node));
+                if (pw.labels[at].parent != CityInterner::INVALID_ID) {
+                    route.modes.push_back(slotAttributes[pw.labels[at].slot].mode);
+                }
+            }
+            reverse(route.path.begin(), route.path.end());
+            reverse(route.modes.begin(), route.modes.end());
+            routes.push_back(move(route));
+        }
+        sort(routes.begin(), routes.end(), [](const RoutePlan& a, const RoutePlan& b) {
+            return tie(a.distance, a.price, a.duration, a.legs) < tie(b.distance, b.price, b.duration, b.legs);
+        });
+        
+        if (stats) {
+            *stats = localStats;
+        }
+        return routes;
+    }
+    
+    // Totals and modes along a path of city names, taking the shortest
+    // route for each leg; false if two consecutive cities are not joined
+    bool describePath(const vector<string>& path, RoutePlan& plan) const {
+        ensureFrozen();
+        plan = RoutePlan();
+        plan.path = path;
+        for (size_t i = 0; i + 1 < path.size(); i++) {
+            uint32_t u = cities->find(path[i]);
+            uint32_t v = cities->find(path[i + 1]);
+            if (u == CityInterner::INVALID_ID || v == CityInterner::INVALID_ID) return false;
+            
+            uint32_t best = UINT32_MAX;
+            for (uint32_t e = csr.offsets[u]; e < csr.offsets[u + 1]; e++) {
+                if (csr.targets[e] == v && (best == UINT32_MAX || csr.weights[e] < csr.weights[best])) best = e;
+            }
+            if (best == UINT32_MAX) return false;
+            
+            const RouteAttributes& leg = slotAttributes[best];
+            plan.distance += leg.distance;
+            plan.price += leg.price;
+            plan.duration += leg.duration;
+            plan.legs++;
+            plan.modes.push_back(leg.mode);
+        }
+        return true;
+    }
+    
+    // Shortest distances from every source to every target (-1 when
+    // unreachable or unknown). Each row is a one-to-all search that stops
+    // once all targets are settled; rows are spread over the thread pool
+    // and run in each worker's own QueryWorkspace.
+    vector<vector<int>> distanceMatrix(const vector<string>& sources, const vector<string>& targets) const {
+        ensureFrozen();
+        uint32_t n = csr.nodeCount();
+        vector<vector<int>> matrix(sources.size(), vector<int>(targets.size(), -1));
+        
+        vector<uint32_t> targetIds(targets.size());
+        vector<uint32_t> targetMultiplicity(n, 0);
+        uint32_t knownTargets = 0;
+        for (size_t j = 0; j < targets.size(); j++) {
+            targetIds[j] = cities->find(targets[j]);
+            if (targetIds[j] != CityInterner::INVALID_ID) {
+                targetMultiplicity[targetIds[j]]++;
+                knownTargets++;
+            }
+        }
+        
+        ThreadPool::shared().parallelFor(sources.size(), [&](size_t row, unsigned) {
+            uint32_t src = cities->find(sources[row]);
+            if (src == CityInterner::INVALID_ID) return;
+            
+            QueryWorkspace& ws = QueryWorkspace::local();
+            ws.begin(n);
+            ws.label(0, src, 0, CityInterner::INVALID_ID);
+            ws.push(0, 0, src);
+            uint32_t remainingTargets = knownTargets;
+            
+            while (!ws.empty(0) && remainingTargets > 0) {
+                int currentDist = ws.top(0).first;
+                uint32_t current = ws.top(0).second;
+                ws.pop(0);
+                
+                if (currentDist > ws.distance(0, current)) continue;
+                remainingTargets -= targetMultiplicity[current];
+                
+                for (uint32_t e = csr.offsets[current]; e < csr.offsets[current + 1]; e++) {
+                    uint32_t next = csr.targets[e];
+                    int newDist = currentDist + csr.weights[e];
+                    if (newDist < ws.distance(0, next)) {
+                        ws.label(0, next, newDist, current);
+                        ws.push(0, newDist, next);
+                    }
+                }
+            }
+            
+            for (size_t j = 0; j < targetIds.size(); j++) {
+                uint32_t t = targetIds[j];
+                if (t != CityInterner::INVALID_ID && ws.reached(0, t)) {
+                    matrix[row][j] = ws.distance(0, t);
+                }
+            }
+        });
+        
+        return matrix;
+    }
+    
+    // Display all available routes
+    void displayRoutes() const {
+        ensureFrozen();
+        cout << "\n=== Available Routes ===\n";
+        for (uint32_t u = 0; u < csr.nodeCount(); u++) {
+            if (csr.offsets[u] == csr.offsets[u + 1]) continue;
+            cout << cities->name(u) << " connects to: ";
+            for (uint32_t e = csr.offsets[u]; e < csr.offsets[u + 1]; e++) {
+                cout << cities->name(csr.targets[e]) << "(" << csr.weights[e] << "km) ";
+            }
+            cout << "\n";
+        }
+    }
+};
+
+// An ordered tour through required stops
+struct Itinerary {
+    vector<string> stops;      // visiting order from the start city (back to it for a round trip)
+    vector<int> legDistances;  // legDistances[i] joins stops[i] and stops[i + 1]
+    int totalDistance = -1;    // -1 when some stop cannot be reached
+    bool optimal = false;      // solved exactly rather than by local search
+    
+    // Each leg as a planned Trip on consecutive days from firstDay, priced
+    // from the routes it takes
+    vector<Trip> legs(const RouteGraph& graph, CityInterner& names, int32_t firstDay) const {
+        vector<Trip> trips;
+        for (size_t i = 0; i < legDistances.size(); i++) {
+            RoutePlan plan;
+            auto route = graph.findShortestPath(stops[i], stops[i + 1]);
+            int cost = graph.describePath(route.second, plan) ? plan.price : legDistances[i] / 10;
+            trips.push_back(Trip(names.intern(stops[i]), names.intern(stops[i + 1]), legDistances[i], cost,
+                                 firstDay + static_cast<int32_t>(i)));
+        }
+        return trips;
+    }
+};
+
+// Orders a set of required stops to minimise the distance travelled from
+// a fixed start city, optionally returning to it. Pairwise distances come
+// from one RouteGraph::distanceMatrix call. Up to EXACT_LIMIT stops are
+// solved exactly with the Held-Karp dynamic program; larger sets run
+// iterated 2-opt and Or-opt local search on every pool worker, each from
+// its own randomised nearest-neighbour tour with double-bridge kicks,
+// until the time budget is spent, and the best tour wins.
+class ItineraryPlanner {
+private:
+    static constexpr int UNREACHABLE = INT_MAX / 4;
+    typedef chrono::steady_clock Clock;
+    
+    // Distances between matrix nodes; node 0 is the start
+    struct Costs {
+        uint32_t n = 0;
+        vector<int> d;
+        bool closed = false;
+        
+        int at(uint32_t a, uint32_t b) const {
+            return d[a * n + b];
+        }
+        
+        // Cost of the edge leaving tour position i, or 0 past the end of
+        // an open tour
+        int next(const vector<uint32_t>& tour, size_t i) const {
+            if (i + 1 < tour.size()) return at(tour[i], tour[i + 1]);
+            return closed ? at(tour[i], tour[0]) : 0;
+        }
+        
+        long long length(const vector<uint32_t>& tour) const {
+            long long total = 0;
+            for (size_t i = 0; i < tour.size(); i++) total += next(tour, i);
+            return total;
+        }
+    };
+    
+    // Held-Karp over subsets of the stops: best[mask][j] is the shortest
+    // path from the start through mask ending at stop j
+    static vector<uint32_t> solveExact(const Costs& costs) {
+        uint32_t m = costs.n - 1;
+        vector<uint32_t> tour = {0};
+        if (m == 0) return tour;
+        
+        size_t subsets = size_t(1) << m;
+        vector<int> best(subsets * m, UNREACHABLE);
+        vector<uint8_t> parent(subsets * m, 0);
+        for (uint32_t j = 0; j < m; j++) {
+            best[(size_t(1) << j) * m + j] = costs.at(0, j + 1);
+        }
+        for (size_t mask = 1; mask < subsets; mask++) {
+            for (uint32_t j = 0; j < m; j++) {
+                int here = best[mask * m + j];
+                if (!(mask >> j & 1) || here >= UNREACHABLE) continue;
+                for (uint32_t k = 0; k < m; k++) {
+                    if (mask >> k & 1) continue;
+                    size_t grown = (mask | size_t(1) << k) * m + k;
+                    int candidate = here + costs.at(j + 1, k + 1);
+                    if (candidate < best[grown]) {
+                        best[grown] = candidate;
+                        parent[grown] = j;
+                    }
+                }
+            }
+        }
+        
+        size_t full = subsets - 1;
+        uint32_t last = 0;
+        long long bestLength = LLONG_MAX;
+        for (uint32_t j = 0; j < m; j++) {
+            long long length = static_cast<long long>(best[full * m + j]) + (costs.closed ? costs.at(j + 1, 0) : 0);
+            if (length < bestLength) {
+                bestLength = length;
+                last = j;
+            }
+        }
+        for (size_t mask = full; mask; ) {
+            tour.push_back(last + 1);
+            uint32_t previous = parent[mask * m + last];
+            mask &= ~(size_t(1) << last);
+            last = previous;
+        }
+        reverse(tour.begin() + 1, tour.end());
+        return tour;
+    }
+    
+    // Nearest-neighbour tour that picks among the `spread` closest
+    // unvisited stops at random, so restarts start from different tours
+    static vector<uint32_t> randomizedGreedy(const Costs& costs, size_t spread, mt19937& rng) {
+        vector<uint32_t> tour = {0};
+        vector<bool> used(costs.n, false);
+        used[0] = true;
+        vector<pair<int, uint32_t>> nearest;
+        while (tour.size() < costs.n) {
+            nearest.clear();
+            for (uint32_t v = 1; v < costs.n; v++) {
+                if (!used[v]) nearest.push_back({costs.at(tour.back(), v), v});
+            }
+            size_t choices = min(spread, nearest.size());
+            partial_sort(nearest.begin(), nearest.begin() + choices, nearest.end());
+            uint32_t v = nearest[rng() % choices].second;
+            used[v] = true;
+            tour.push_back(v);
+        }
+        return tour;
+    }
+    
+    // One pass of 2-opt segment reversals; true if the tour got shorter
+    static bool twoOpt(const Costs& costs, vector<uint32_t>& tour) {
+        bool improved = false;
+        size_t n = tour.size();
+        for (size_t i = 1; i + 1 < n; i++) {
+            for (size_t j = i + 1; j < n; j++) {
+                // Reverse tour[i..j]; routes are undirected, so only the
+                // two boundary edges change
+                int before = costs.at(tour[i - 1], tour[i]) + costs.next(tour, j);
+                int after = costs.at(tour[i - 1], tour[j]);
+                if (j + 1 < n) after += costs.at(tour[i], tour[j + 1]);
+                else if (costs.closed) after += costs.at(tour[i], tour[0]);
+                if (after < before) {
+                    reverse(tour.begin() + i, tour.begin() + j + 1);
+                    improved = true;
+                }
+            }
+        }
+        return improved;
+    }
+    
+    // Move the run tour[i..i+length) to its best improving place, either
+    // way round; true if it moved
+    static bool moveRun(const Costs& costs, vector<uint32_t>& tour, size_t i, size_t length) {
+        size_t n = tour.size();
+        size_t j = i + length - 1;
+        long long removed = costs.at(tour[i - 1], tour[i]) + costs.next(tour, j);
+        long long bridged = j + 1 < n ? costs.at(tour[i - 1], tour[j + 1])
+                                      : (costs.closed ? costs.at(tour[i - 1], tour[0]) : 0);
+        long long gain = removed - bridged;
+        
+        // Insert between tour[p] and its successor, outside the run
+        for (size_t p = 0; p < n; p++) {
+            if (p + 1 >= i && p <= j) continue;
+            uint32_t before = tour[p];
+            uint32_t after = p + 1 < n ? tour[p + 1] : tour[0];
+            bool hasAfter = p + 1 < n || costs.closed;
+            long long opened = hasAfter ? costs.at(before, after) : 0;
+            
+            for (int reversed = 0; reversed < 2; reversed++) {
+                uint32_t first = reversed ? tour[j] : tour[i];
+                uint32_t last = reversed ? tour[i] : tour[j];
+                long long added = costs.at(before, first) + (hasAfter ? costs.at(last, after) : 0);
+                if (added - opened < gain) {
+                    vector<uint32_t> run(tour.begin() + i, tour.begin() + j + 1);
+                    if (reversed) reverse(run.begin(), run.end());
+                    tour.erase(tour.begin() + i, tour.begin() + j + 1);
+                    tour.insert(tour.begin() + (p < i ? p + 1 : p + 1 - length), run.begin(), run.end());
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+    
+    // One pass of Or-opt over runs of 1-3 stops; true if the tour got shorter
+    static bool orOpt(const Costs& costs, vector<uint32_t>& tour) {
+        bool improved = false;
+        for (size_t length = 1; length <= 3; length++) {
+            for (size_t i = 1; i + length <= tour.size(); i++) {
+                improved |= moveRun(costs, tour, i, length);
+            }
+        }
+        return improved;
+    }
+    
+    // Improve until neither move helps or the deadline passes
+    static void localSearch(const Costs& costs, vector<uint32_t>& tour, Clock::time_point deadline) {
+        while (Clock::now() < deadline && (twoOpt(costs, tour) || orOpt(costs, tour))) {}
+    }
+    
+    // Double-bridge kick: cut into four runs A B C D and reconnect A C B D
+    static void doubleBridge(vector<uint32_t>& tour, mt19937& rng) {
+        size_t n = tour.size();
+        if (n < 8) {
+            swap(tour[1 + rng() % (n - 1)], tour[1 + rng() % (n - 1)]);
+            return;
+        }
+        size_t cuts[3];
+        for (size_t& cut : cuts) cut = 1 + rng() % (n - 1);
+        sort(cuts, cuts + 3);
+        vector<uint32_t> kicked(tour.begin(), tour.begin() + cuts[0]);
+        kicked.insert(kicked.end(), tour.begin() + cuts[1], tour.begin() + cuts[2]);
+        kicked.insert(kicked.end(), tour.begin() + cuts[0], tour.begin() + cuts[1]);
+        kicked.insert(kicked.end(), tour.begin() + cuts[2], tour.end());
+        tour.swap(kicked);
+    }
+    
+public:
+    // Largest number of stops solved exactly (2^15 * 15 states)
+    static constexpr uint32_t EXACT_LIMIT = 15;
+    
+    // Visit every stop once starting from start. The time budget bounds
+    // the local search that follows the distance matrix, so latency stays
+    // near it for large stop sets; exactLimit lowers the exact/heuristic
+    // cut-off.
+    static Itinerary plan(const RouteGraph& graph, const string& start, const vector<string>& requiredStops,
+                          bool returnToStart = false, chrono::milliseconds timeBudget = chrono::milliseconds(200),
+                          uint32_t exactLimit = EXACT_LIMIT) {
+        Itinerary itinerary;
+        
+        vector<string> nodes = {start};
+        for (const string& stop : requiredStops) {
+            if (find(nodes.begin(), nodes.end(), stop) == nodes.end()) nodes.push_back(stop);
+        }
+        
+        Costs costs;
+        costs.n = nodes.size();
+        costs.closed = returnToStart;
+        costs.d.resize(costs.n * costs.n);
+        vector<vector<int>> matrix = graph.distanceMatrix(nodes, nodes);
+        for (uint32_t a = 0; a < costs.n; a++) {
+            for (uint32_t b = 0; b < costs.n; b++) {
+                if (matrix[a][b] < 0) return itinerary; // Unreachable stop
+                costs.d[a * costs.n + b] = matrix[a][b];
+            }
+        }
+        
+        auto deadline = Clock::now() + timeBudget;
+        vector<uint32_t> best;
+        if (costs.n - 1 <= min(exactLimit, EXACT_LIMIT)) {
+            best = solveExact(costs);
+            itinerary.optimal = true;
+        } else {
+            ThreadPool& pool = ThreadPool::shared();
+            vector<vector<uint32_t>> found(pool.size());
+            pool.parallelFor(pool.size(), [&](size_t restart, unsigned) {
+                mt19937 rng(static_cast<uint32_t>(restart) * 7919 + 1);
+                // Worker 0 starts from the plain nearest-neighbour tour
+                vector<uint32_t> current = randomizedGreedy(costs, restart == 0 ? 1 : 3, rng);
+                localSearch(costs, current, deadline);
+                vector<uint32_t> bestHere = current;
+                long long bestLength = costs.length(current);
+                
+                // Iterated local search from the best tour seen so far
+                while (Clock::now() < deadline) {
+                    current = bestHere;
+                    doubleBridge(current, rng);
+                    localSearch(costs, current, deadline);
+                    long long length = costs.length(current);
+                    if (length < bestLength) {
+                        bestLength = length;
+                        bestHere = current;
+                    }
+                }
+                found[restart] = move(bestHere);
+            });
+            best = *min_element(found.begin(), found.end(), [&](const vector<uint32_t>& a, const vector<uint32_t>& b) {
+                return costs.length(a) < costs.length(b);
+            });
+        }
+        
+        if (returnToStart) best.push_back(0);
+        itinerary.totalDistance = 0;
+        for (size_t i = 0; i < best.size(); i++) {
+            itinerary.stops.push_back(nodes[best[i]]);
+            if (i > 0) {
+                itinerary.legDistances.push_back(costs.at(best[i - 1], best[i]));
+                itinerary.totalDistance += itinerary.legDistances.back();
+            }
+        }
+        return itinerary;
+    }
+};
+
+// Trip fields usable as sort keys
+enum class TripKey : uint8_t { Cost, Distance, Date };
+
+// Stable multi-key trip sorting. Orders are computed as index
+// permutations so 24-byte Trips are never moved while sorting: each key,
+// least significant first, is gathered into (key, index) pairs and LSD
+// radix sorted 8 bits at a time. Large inputs split every radix pass
+// into per-thread chunks with their own histograms, which keeps the
+// parallel scatter stable. Small inputs fall back to stable_sort.
+class TripSorter {
+private:
+    struct Item {
+        uint32_t key;
+        uint32_t index;
+    };
+    
+    static constexpr size_t PARALLEL_CHUNK = 1 << 16;
+    static constexpr size_t RADIX_THRESHOLD = 1 << 11;
+    
+    // Signed key flipped so unsigned order matches numeric order
+    static uint32_t keyOf(const Trip& trip, TripKey key) {
+        int32_t value = key == TripKey::Cost ? trip.cost : key == TripKey::Distance ? trip.distance : trip.day;
+        return static_cast<uint32_t>(value) ^ 0x80000000u;
+    }
+    
+    // Run fn(chunk, from, to) over [0, n) split into equal chunks
+    static void forChunks(size_t n, unsigned chunks, const function<void(size_t, size_t, size_t)>& fn) {
+        size_t chunkSize = (n + chunks - 1) / chunks;
+        auto body = [&](size_t c, unsigned) {
+            fn(c, c * chunkSize, min(n, (c + 1) * chunkSize));
+        };
+        if (chunks == 1) body(0, 0);
+        else ThreadPool::shared().parallelFor(chunks, body);
+    }
+    
+    // One stable counting pass on the byte at shift, from in to out
+    static bool radixPass(const Item* in, Item* out, size_t n, unsigned shift, unsigned chunks) {
+        vector<array<size_t, 256>> counts(chunks);
+        forChunks(n, chunks, [&](size_t c, size_t from, size_t to) {
+            array<size_t, 256>& count = counts[c];
+            count.fill(0);
+            for (size_t i = from; i < to; i++) count[(in[i].key >> shift) & 0xFF]++;
+        });
+        
+        // Every key has the same byte here: nothing to reorder
+        for (unsigned digit = 0; digit < 256; digit++) {
+            size_t total = 0;
+            for (const auto& count : counts) total += count[digit];
+            if (total == n) return false;
+            if (total != 0) break;
+        }
+        
+        size_t offset = 0;
+        for (unsigned digit = 0; digit < 256; digit++) {
+            for (auto& count : counts) {
+                size_t c = count[digit];
+                count[digit] = offset;
+                offset += c;
+            }
+        }
+        forChunks(n, chunks, [&](size_t c, size_t from, size_t to) {
+            array<size_t, 256>& next = counts[c];
+            for (size_t i = from; i < to; i++) out[next[(in[i].key >> shift) & 0xFF]++] = in[i];
+        });
+        return true;
+    }
+    
+public:
+    // Indices of trips in ascending order of keys (first key most
+    // significant); trips with equal keys keep their relative order
+    static vector<uint32_t> sortedOrder(const vector<Trip>& trips, const vector<TripKey>& keys) {
+        size_t n = trips.size();
+        vector<uint32_t> order(n);
+        for (size_t i = 0; i < n; i++) order[i] = i;
+        
+        if (n < RADIX_THRESHOLD) {
+            stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+                for (TripKey key : keys) {
+                    uint32_t ka = keyOf(trips[a], key), kb = keyOf(trips[b], key);
+                    if (ka != kb) return ka < kb;
+                }
+                return false;
+            });
+            return order;
+        }
+        
+        unsigned chunks = static_cast<unsigned>(min<size_t>(ThreadPool::shared().size(), max<size_t>(1, n / PARALLEL_CHUNK)));
+        vector<Item> items(n), scratch(n);
+        for (size_t k = keys.size(); k-- > 0;) {
+            TripKey key = keys[k];
+            forChunks(n, chunks, [&](size_t, size_t from, size_t to) {
+                for (size_t i = from; i < to; i++) items[i] = {keyOf(trips[order[i]], key), order[i]};
+            });
+            for (unsigned shift = 0; shift < 32; shift += 8) {
+                if (radixPass(items.data(), scratch.data(), n, shift, chunks)) items.swap(scratch);
+            }
+            forChunks(n, chunks, [&](size_t, size_t from, size_t to) {
+                for (size_t i = from; i < to; i++) order[i] = items[i].index;
+            });
+        }
+        return order;
+    }
+    
+    // Reorder trips in place by keys, moving each trip once
+    static void sort(vector<Trip>& trips, const vector<TripKey>& keys) {
+        vector<uint32_t> order = sortedOrder(trips, keys);
+        vector<Trip> sorted;
+        sorted.reserve(trips.size());
+        for (uint32_t index : order) sorted.push_back(trips[index]);
+        trips.swap(sorted);
+    }
+};
+
+// Future trips ordered by date, as a calendar: an ordered map from day
+// to the IDs scheduled that day. Each trip gets an ID (slots are reused
+// after it leaves) and remembers its index in its day's list, so insert,
+// cancel-by-ID and reschedule cost one O(log days) map lookup plus O(1)
+// list work; date-range queries and popping due trips only touch the
+// days involved. Trips on the same day are listed in ID order.
+class TripScheduler {
+private:
+    static constexpr uint32_t UNSCHEDULED = UINT32_MAX;
+    
+    map<int32_t, vector<uint32_t>> calendar;
+    vector<Trip> trips;            // by ID
+    vector<uint32_t> slot;         // index in the day's list, or UNSCHEDULED
+    vector<uint32_t> freeIds;
+    size_t count = 0;
+    
+    void link(uint32_t id) {
+        vector<uint32_t>& day = calendar[trips[id].day];
+        slot[id] = day.size();
+        day.push_back(id);
+    }
+    
+    // Swap-remove id from its day, dropping the day once it is empty
+    void unlink(uint32_t id) {
+        auto it = calendar.find(trips[id].day);
+        vector<uint32_t>& day = it->second;
+        uint32_t moved = day.back();
+        day[slot[id]] = moved;
+        slot[moved] = slot[id];
+        day.pop_back();
+        if (day.empty()) calendar.erase(it);
+        slot[id] = UNSCHEDULED;
+    }
+    
+    static void sortedIds(const vector<uint32_t>& ids, vector<uint32_t>& out) {
+        out.assign(ids.begin(), ids.end());
+        sort(out.begin(), out.end());
+    }
+    
+public:
+    static constexpr uint32_t INVALID_ID = UINT32_MAX;
+    
+    bool empty() const {
+        return count == 0;
+    }
+    
+    size_t size() const {
+        return count;
+    }
+    
+    void reserve(size_t n) {
+        trips.reserve(n);
+        slot.reserve(n);
+    }
+    
+    void clear() {
+        calendar.clear();
+        freeIds.clear();
+        for (uint32_t id = trips.size(); id-- > 0;) {
+            slot[id] = UNSCHEDULED;
+            freeIds.push_back(id);
+        }
+        count = 0;
+    }
+    
+    // Add a trip and return its ID
+    uint32_t schedule(const Trip& trip) {
+        uint32_t id;
+        if (!freeIds.empty()) {
+            id = freeIds.back();
+            freeIds.pop_back();
+            trips[id] = trip;
+        } else {
+            id = trips.size();
+            trips.push_back(trip);
+            slot.push_back(UNSCHEDULED);
+        }
+        link(id);
+        count++;
+        return id;
+    }
+    
+    bool contains(uint32_t id) const {
+        return id < slot.size() && slot[id] != UNSCHEDULED;
+    }
+    
+    const Trip& trip(uint32_t id) const {
+        return trips[id];
+    }
+    
+    // ID of the earliest trip; the scheduler must not be empty
+    uint32_t next() const {
+        const vector<uint32_t>& day = calendar.begin()->second;
+        return *min_element(day.begin(), day.end());
+    }
+    
+    // Remove a trip, returning it through removed; false for unknown IDs
+    bool cancel(uint32_t id, Trip* removed = nullptr) {
+        if (!contains(id)) return false;
+        if (removed) *removed = trips[id];
+        unlink(id);
+        freeIds.push_back(id);
+        count--;
+        return true;
+    }
+    
+    bool reschedule(uint32_t id, int32_t day) {
+        if (!contains(id)) return false;
+        unlink(id);
+        trips[id].day = day;
+        link(id);
+        return true;
+    }
+    
+    // Remove every trip dated on or before day, appending them to due in
+    // date order; returns how many were removed
+    size_t popDue(int32_t day, vector<Trip>& due) {
+        size_t before = due.size();
+        vector<uint32_t> ids;
+        auto end = calendar.upper_bound(day);
+        for (auto it = calendar.begin(); it != end; ++it) {
+            sortedIds(it->second, ids);
+            for (uint32_t id : ids) {
+                due.push_back(trips[id]);
+                slot[id] = UNSCHEDULED;
+                freeIds.push_back(id);
+            }
+        }
+        calendar.erase(calendar.begin(), end);
+        count -= due.size() - before;
+        return due.size() - before;
+    }
+    
+    // Visit (id, trip) for trips dated in [fromDay, toDay], in date order
+    template <typename Visitor>
+    void forEachInRange(int32_t fromDay, int32_t toDay, Visitor visit) const {
+        vector<uint32_t> ids;
+        for (auto it = calendar.lower_bound(fromDay); it != calendar.end() && it->first <= toDay; ++it) {
+            sortedIds(it->second, ids);
+            for (uint32_t id : ids) visit(id, trips[id]);
+        }
+    }
+    
+    template <typename Visitor>
+    void forEachTrip(Visitor visit) const {
+        forEachInRange(INT32_MIN, INT32_MAX, visit);
+    }
+    
+    // All trips in date order, e.g. for persistence
+    vector<Trip> ordered() const {
+        vector<Trip> result;
+        result.reserve(size());
+        forEachTrip([&](uint32_t, const Trip& trip) { result.push_back(trip); });
+        return result;
+    }
+};
+
+// Trip rows with fromDay <= day <= toDay whose status bit is set in statuses
+struct TripFilter {
+    int32_t fromDay = INT32_MIN;
+    int32_t toDay = INT32_MAX;
+    uint8_t statuses = 0xFF;
+    
+    static uint8_t only(TripStatus status) {
+        return 1u << static_cast<unsigned>(status);
+    }
+};
+
+// Columnar copy of trips for reports. Each field is its own contiguous
+// array, so filter/aggregate kernels stream only the columns they use;
+// the inner loops are branch-free (predicates become 0/1 masks) so the
+// compiler can vectorize them. Dates are also kept as month numbers so
+// grouping by month needs no calendar math per query.
+class TripColumns {
+public:
+    enum class Column : uint8_t { Cost, Distance, Day };
+    
+    typedef TripFilter Filter;
+    
+    struct Aggregate {
+        size_t count = 0;
+        int64_t sum = 0;
+        int32_t min = INT32_MAX;
+        int32_t max = INT32_MIN;
+        
+        double mean() const {
+            return count ? static_cast<double>(sum) / count : 0.0;
+        }
+    };
+    
+    struct Group {
+        uint64_t key;   // month number, or source << 32 | destination
+        Aggregate value;
+    };
+    
+private:
+    vector<int32_t> costs;
+    vector<int32_t> distances;
+    vector<int32_t> days;
+    vector<int32_t> months;
+    vector<uint8_t> statuses;
+    vector<uint32_t> sources;
+    vector<uint32_t> destinations;
+    
+    const vector<int32_t>& column(Column c) const {
+        return c == Column::Cost ? costs : c == Column::Distance ? distances : days;
+    }
+    
+    static constexpr size_t BLOCK = 2048;
+    
+    // Call visit(first, count, mask) for consecutive row blocks, where mask
+    // holds 0/1 for whether each row passes the filter
+    template <typename Visitor>
+    void forEachBlock(const Filter& filter, Visitor visit) const {
+        uint8_t mask[BLOCK];
+        const int32_t* day = days.data();
+        const uint8_t* status = statuses.data();
+        for (size_t first = 0; first < size(); first += BLOCK) {
+            size_t count = min(BLOCK, size() - first);
+            for (size_t i = 0; i < count; i++) {
+                size_t row = first + i;
+                mask[i] = (day[row] >= filter.fromDay) & (day[row] <= filter.toDay) &
+                          ((filter.statuses >> status[row]) & 1);
+            }
+            visit(first, count, static_cast<const uint8_t*>(mask));
+        }
+    }
+    
+    // Fold masked values into an aggregate without branching per row
+    static void accumulate(const int32_t* values, const uint8_t* mask, size_t n, Aggregate& into) {
+        int64_t sum = 0;
+        size_t count = 0;
+        int32_t low = INT32_MAX, high = INT32_MIN;
+        for (size_t i = 0; i < n; i++) {
+            int32_t keep = -static_cast<int32_t>(mask[i]);   // all ones or zero
+            int32_t v = values[i];
+            sum += v & keep;
+            count += mask[i];
+            low = min(low, (v & keep) | (INT32_MAX & ~keep));
+            high = max(high, (v & keep) | (INT32_MIN & ~keep));
+        }
+        into.count += count;
+        into.sum += sum;
+        into.min = min(into.min, low);
+        into.max = max(into.max, high);
+    }
+    
+    template <typename KeyOf>
+    vector<Group> groupBy(Column c, const Filter& filter, KeyOf keyOf) const {
+        const vector<int32_t>& values = column(c);
+        unordered_map<uint64_t, Aggregate> groups;
+        forEachBlock(filter, [&](size_t first, size_t count, const uint8_t* mask) {
+            for (size_t i = 0; i < count; i++) {
+                if (!mask[i]) continue;
+                size_t row = first + i;
+                Aggregate& group = groups[keyOf(row)];
+                group.count++;
+                group.sum += values[row];
+                group.min = min(group.min, values[row]);
+                group.max = max(group.max, values[row]);
+            }
+        });
+        vector<Group> result;
+        result.reserve(groups.size());
+        for (const auto& group : groups) result.push_back({group.first, group.second});
+        return result;
+    }
+    
+public:
+    size_t size() const {
+        return costs.size();
+    }
+    
+    void reserve(size_t n) {
+        costs.reserve(n);
+        distances.reserve(n);
+        days.reserve(n);
+        months.reserve(n);
+        statuses.reserve(n);
+        sources.reserve(n);
+        destinations.reserve(n);
+    }
+    
+    void clear() {
+        costs.clear();
+        distances.clear();
+        days.clear();
+        months.clear();
+        statuses.clear();
+        sources.clear();
+        destinations.clear();
+    }
+    
+    void append(const Trip& trip) {
+        costs.push_back(trip.cost);
+        distances.push_back(trip.distance);
+        days.push_back(trip.day);
+        months.push_back(Trip::monthNumber(trip.day));
+        statuses.push_back(static_cast<uint8_t>(trip.status));
+        sources.push_back(trip.source);
+        destinations.push_back(trip.destination);
+    }
+    
+    // sum/count/min/max of one column over the filtered rows
+    Aggregate aggregate(Column c, const Filter& filter = Filter()) const {
+        return aggregate(vector<Column>{c}, filter)[0];
+    }
+    
+    // Several columns under one filter, evaluating the predicate once
+    vector<Aggregate> aggregate(const vector<Column>& columns, const Filter& filter = Filter()) const {
+        vector<Aggregate> results(columns.size());
+        forEachBlock(filter, [&](size_t first, size_t count, const uint8_t* mask) {
+            for (size_t k = 0; k < columns.size(); k++) {
+                accumulate(column(columns[k]).data() + first, mask, count, results[k]);
+            }
+        });
+        return results;
+    }
+    
+    // Row count per TripStatus value
+    array<size_t, 3> statusCounts(const Filter& filter = Filter()) const {
+        array<size_t, 3> counts = {0, 0, 0};
+        forEachBlock(filter, [&](size_t first, size_t count, const uint8_t* mask) {
+            const uint8_t* status = statuses.data() + first;
+            for (unsigned s = 0; s < counts.size(); s++) {
+                size_t matched = 0;
+                for (size_t i = 0; i < count; i++) matched += mask[i] & (status[i] == s);
+                counts[s] += matched;
+            }
+        });
+        return counts;
+    }
+    
+    // Counts of a column in buckets [k * width, (k + 1) * width); negative
+    // values fall into bucket 0 and the last bucket takes the overflow
+    vector<size_t> histogram(Column c, int32_t width, size_t buckets, const Filter& filter = Filter()) const {
+        const int32_t* values = column(c).data();
+        vector<size_t> counts(buckets, 0);
+        if (buckets == 0 || width <= 0) return counts;
+        forEachBlock(filter, [&](size_t first, size_t count, const uint8_t* mask) {
+            for (size_t i = 0; i < count; i++) {
+                size_t bucket = min<size_t>(max(values[first + i], 0) / width, buckets - 1);
+                counts[bucket] += mask[i];
+            }
+        });
+        return counts;
+    }
+    
+    // Aggregates of a column per month, in month order
+    vector<Group> groupByMonth(Column c, const Filter& filter = Filter()) const {
+        // Months span a small range, so group into a dense array
+        Aggregate range;
+        forEachBlock(filter, [&](size_t first, size_t count, const uint8_t* mask) {
+            accumulate(months.data() + first, mask, count, range);
+        });
+        vector<Group> groups;
+        if (range.count == 0) return groups;
+        
+        vector<Aggregate> dense(range.max - range.min + 1);
+        const vector<int32_t>& values = column(c);
+        forEachBlock(filter, [&](size_t first, size_t count, const uint8_t* mask) {
+            for (size_t i = 0; i < count; i++) {
+                if (!mask[i]) continue;
+                size_t row = first + i;
+                Aggregate& group = dense[months[row] - range.min];
+                group.count++;
+                group.sum += values[row];
+                group.min = min(group.min, values[row]);
+                group.max = max(group.max, values[row]);
+            }
+        });
+        for (size_t m = 0; m < dense.size(); m++) {
+            if (dense[m].count > 0) groups.push_back({static_cast<uint64_t>(range.min + m), dense[m]});
+        }
+        return groups;
+    }
+    
+    // Aggregates of a column per (source, destination), busiest first
+    vector<Group> groupByRoute(Column c, const Filter& filter = Filter()) const {
+        vector<Group> groups = groupBy(c, filter, [this](size_t i) {
+            return static_cast<uint64_t>(sources[i]) << 32 | destinations[i];
+        });
+        sort(groups.begin(), groups.end(), [](const Group& a, const Group& b) {
+            return a.value.count != b.value.count ? a.value.count > b.value.count : a.key < b.key;
+        });
+        return groups;
+    }
+};
+
+// Immutable, read-optimized view of the planner's data. Published
+// snapshots are never modified, so any number of threads may query one.
+// The city list and ranking are shared with the versions before and
+// after it until a new version changes the cities.
+class PlannerSnapshot {
+private:
+    uint64_t versionNumber = 0;
+    RouteGraph routes;  // frozen before publication
+    // Sorted by name, and indices into it, most popular first
+    shared_ptr<const vector<City>> cities = make_shared<vector<City>>();
+    shared_ptr<const vector<uint32_t>> ranking = make_shared<vector<uint32_t>>();
+    
+    friend class QueryEngine;
+    
+public:
+    uint64_t version() const {
+        return versionNumber;
+    }
+    
+    const RouteGraph& routeGraph() const {
+        return routes;
+    }
+    
+    size_t cityCount() const {
+        return cities->size();
+    }
+    
+    pair<int, vector<string>> findShortestPath(const string& source, const string& destination,
+                                               SearchMode mode = SearchMode::Dijkstra) const {
+        return routes.findShortestPath(source, destination, mode);
+    }
+    
+    // Binary search by name; nullptr when the city is unknown
+    const City* findCity(const string& cityName) const {
+        auto it = lower_bound(cities->begin(), cities->end(), cityName,
+                              [](const City& c, const string& name) { return c.name < name; });
+        return it != cities->end() && it->name == cityName ? &*it : nullptr;
+    }
+    
+    // All cities sorted by name, without copying
+    ArrayView<City> allCities() const {
+        return ArrayView<City>(cities->data(), cities->size());
+    }
+    
+    // Visit the n most popular cities in order
+    template <typename Visitor>
+    void forEachTopDestination(size_t n, Visitor visit) const {
+        for (size_t i = 0; i < n && i < ranking->size(); i++) {
+            visit((*cities)[(*ranking)[i]]);
+        }
+    }
+    
+    // The n most popular cities, pointing into this snapshot
+    vector<const City*> topDestinations(size_t n) const {
+        vector<const City*> result;
+        for (size_t i = 0; i < n && i < ranking->size(); i++) {
+            result.push_back(&(*cities)[(*ranking)[i]]);
+        }
+        return result;
+    }
+};
+
+// Serves queries from the current PlannerSnapshot while a writer builds
+// the next one. Readers only load a shared_ptr; the writer copies the
+// current snapshot, applies a batch and publishes the result with an
+// atomic store. Old snapshots live until their last reader lets go.
+class QueryEngine {
+private:
+    shared_ptr<const PlannerSnapshot> current;
+    mutex writerMutex;
+    
+    // Install a new city list (sorted by name) and its popularity ranking
+    static void setCities(PlannerSnapshot& snapshot, vector<City> cities) {
+        vector<uint32_t> ranking(cities.size());
+        for (uint32_t i = 0; i < ranking.size(); i++) ranking[i] = i;
+        stable_sort(ranking.begin(), ranking.end(), [&cities](uint32_t a, uint32_t b) {
+            return cities[a].popularity > cities[b].popularity;
+        });
+        snapshot.cities = make_shared<const vector<City>>(move(cities));
+        snapshot.ranking = make_shared<const vector<uint32_t>>(move(ranking));
+    }
+    
+    // Every version goes out through here. Const queries on an unfrozen
+    // RouteGraph rebuild its CSR arrays lazily, so the graph is frozen
+    // before any reader can see it. Caller holds writerMutex.
+    uint64_t store(shared_ptr<PlannerSnapshot> next) {
+        next->routes.freeze();
+        uint64_t version = next->versionNumber;
+        atomic_store(&current, shared_ptr<const PlannerSnapshot>(move(next)));
+        return version;
+    }
+    
+public:
+    // Routes and cities to apply together as one new version
+    struct UpdateBatch {
+        struct Route {
+            string city1;
+            string city2;
+            int distance;
+        };
+        vector<Route> routes;
+        vector<City> cities;
+        
+        void addRoute(const string& city1, const string& city2, int distance) {
+            routes.push_back({city1, city2, distance});
+        }
+        
+        void insertCity(const City& city) {
+            cities.push_back(city);
+        }
+    };
+    
+    QueryEngine() : current(make_shared<PlannerSnapshot>()) {}
+    
+    // Pin the current version; safe to call from any thread
+    shared_ptr<const PlannerSnapshot> snapshot() const {
+        return atomic_load(&current);
+    }
+    
+    // Build and publish a new version; returns its version number.
+    // Writers are serialized with each other but never block readers.
+    uint64_t apply(const UpdateBatch& batch) {
+        lock_guard<mutex> lock(writerMutex);
+        shared_ptr<const PlannerSnapshot> base = atomic_load(&current);
+        auto next = make_shared<PlannerSnapshot>(*base);
+        next->versionNumber = base->versionNumber + 1;
+        
+        for (const auto& route : batch.routes) {
+            next->routes.addRoute(route.city1, route.city2, route.distance);
+        }
+        
+        if (!batch.cities.empty()) {
+            // Same rule as CityIndex: the first insert of a name wins
+            vector<City> added;
+            for (const auto& city : batch.cities) {
+                if (!next->findCity(city.name)) added.push_back(city);
+            }
+            stable_sort(added.begin(), added.end(),
+                        [](const City& a, const City& b) { return a.name < b.name; });
+            added.erase(unique(added.begin(), added.end(),
+                               [](const City& a, const City& b) { return a.name == b.name; }),
+                        added.end());
+            
+            // Cities already published keep their coordinates
+            for (const auto& city : added) {
+                if (city.hasCoordinates()) {
+                    next->routes.setCityLocation(city.name, city.latitude, city.longitude);
+                }
+            }
+            
+            const vector<City>& published = *base->cities;
+            vector<City> merged;
+            merged.reserve(published.size() + added.size());
+            merge(published.begin(), published.end(), make_move_iterator(added.begin()),
+                  make_move_iterator(added.end()), back_inserter(merged),
+                  [](const City& a, const City& b) { return a.name < b.name; });
+            setCities(*next, move(merged));
+        }
+        return store(move(next));
+    }
+    
+    // Publish a copy of routes as the next version, sharing the current
+    // version's cities
+    uint64_t publish(const RouteGraph& routes) {
+        lock_guard<mutex> lock(writerMutex);
+        shared_ptr<const PlannerSnapshot> base = atomic_load(&current);
+        auto next = make_shared<PlannerSnapshot>();
+        next->versionNumber = base->versionNumber + 1;
+        next->routes = routes;
+        next->cities = base->cities;
+        next->ranking = base->ranking;
+        return store(move(next));
+    }
+    
+    // Publish a copy of routes and a new city list (in name order) as the
+    // next version
+    uint64_t publish(const RouteGraph& routes, vector<City> cities) {
+        lock_guard<mutex> lock(writerMutex);
+        auto next = make_shared<PlannerSnapshot>();
+        next->versionNumber = atomic_load(&current)->versionNumber + 1;
+        next->routes = routes;
+        setCities(*next, move(cities));
+        return store(move(next));
+    }
+};
+
+// Buffered line reader for large data files; lines are returned as views
+// into an internal buffer and stay valid until the next call
+class LineReader {
+private:
+    FILE* file;
+    vector<char> buffer;
+    size_t begin = 0;
+    size_t end = 0;
+    bool atEof = false;
+    
+public:
+    explicit LineReader(const string& filename, size_t bufferSize = 1 << 20)
+        : file(fopen(filename.c_str(), "rb")), buffer(bufferSize) {}
+    
+    ~LineReader() {
+        if (file) fclose(file);
+    }
+    
+    LineReader(const LineReader&) = delete;
+    LineReader& operator=(const LineReader&) = delete;
+    
+    bool isOpen() const {
+        return file != nullptr;
+    }
+    
+    bool next(string_view& line) {
+        while (true) {
+            const char* start = buffer.data() + begin;
+            const char* newline = static_cast<const char*>(memchr(start, '\n', end - begin));
+            if (newline) {
+                size_t length = newline - start;
+                begin += length + 1;
+                if (length > 0 && start[length - 1] == '\r') length--;
+                line = string_view(start, length);
+                return true;
+            }
+            if (atEof) {
+                if (begin == end) return false;
+                line = string_view(start, end - begin);
+                if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+                begin = end;
+                return true;
+            }
+            
+            // Keep the partial line and refill; grow for very long lines
+            memmove(buffer.data(), start, end - begin);
+            end -= begin;
+            begin = 0;
+            if (end == buffer.size()) buffer.resize(buffer.size() * 2);
+            size_t got = fread(buffer.data() + end, 1, buffer.size() - end, file);
+            end += got;
+            if (got == 0) atEof = true;
+        }
+    }
+    
+    // Count the lines of a file without keeping them, for pre-sizing
+    static size_t countLines(const string& filename) {
+        FILE* f = fopen(filename.c_str(), "rb");
+        if (!f) return 0;
+        vector<char> chunk(1 << 20);
+        size_t lines = 0, got;
+        char last = '\n';
+        while ((got = fread(chunk.data(), 1, chunk.size(), f)) > 0) {
+            for (const char* p = chunk.data(); (p = static_cast<const char*>(memchr(p, '\n', chunk.data() + got - p))); p++) {
+                lines++;
+            }
+            last = chunk[got - 1];
+        }
+        fclose(f);
+        return lines + (last != '\n');
+    }
+};
+
+// Streaming import of a city catalog from delimited files in a directory:
+//   cities.{csv,tsv}       name, country, popularity[, latitude, longitude]
+//   hotels.{csv,tsv}       city, name, rating, pricePerNight
+//   attractions.{csv,tsv}  city, name, rating, type
+//   routes.{csv,tsv}       city1, city2, distance[, price, duration in minutes, mode]
+// Fields are separated by tabs if the first line has one, else commas;
+// quoting is not supported. A first line whose numeric columns do not
+// parse is taken as a header. Cities already in the catalog, self-loop
+// routes and non-finite numbers are rejected. Fields are parsed in place as string_views
+// with std::from_chars; only values that end up stored are copied.
+class CatalogImporter {
+public:
+    struct Stats {
+        size_t cities = 0;
+        size_t hotels = 0;
+        size_t attractions = 0;
+        size_t routes = 0;
+        size_t rejected = 0;   // malformed rows, duplicate or unknown cities
+        double seconds = 0;
+        
+        size_t rows() const {
+            return cities + hotels + attractions + routes;
+        }
+    };
+    
+private:
+    static constexpr size_t MAX_FIELDS = 8;
+    
+    static size_t splitFields(string_view line, char delimiter, string_view* fields) {
+        size_t count = 0;
+        while (count < MAX_FIELDS) {
+            size_t cut = line.find(delimiter);
+            fields[count++] = line.substr(0, cut);
+            if (cut == string_view::npos) break;
+            line.remove_prefix(cut + 1);
+        }
+        return count;
+    }
+    
+    static string_view trim(string_view field) {
+        while (!field.empty() && (field.front() == ' ' || field.front() == '\t')) field.remove_prefix(1);
+        while (!field.empty() && (field.back() == ' ' || field.back() == '\t')) field.remove_suffix(1);
+        return field;
+    }
+    
+    template <typename T>
+    static bool parseNumber(string_view field, T& value) {
+        field = trim(field);
+        auto result = from_chars(field.data(), field.data() + field.size(), value);
+        if (result.ec != errc() || result.ptr != field.data() + field.size()) return false;
+        if constexpr (is_floating_point_v<T>) {
+            return std::isfinite(value); // from_chars accepts "nan" and "inf"
+        }
+        return true;
+    }
+    
+    // First existing <dir>/<stem>.csv or .tsv, or "" if neither exists
+    static string findFile(const string& directory, const string& stem) {
+        for (const char* extension : {".csv", ".tsv"}) {
+            string path = directory + "/" + stem + extension;
+            if (filesystem::exists(path)) return path;
+        }
+        return "";
+    }
+    
+    // Feed each row's fields to handle(fields, count), which returns false
+    // for a row it rejects; a rejected first row counts as a header
+    template <typename Handler>
+    static void forEachRow(const string& path, size_t& rejected, Handler handle) {
+        LineReader reader(path);
+        string_view line, fields[MAX_FIELDS];
+        char delimiter = ',';
+        bool first = true;
+        
+        while (reader.next(line)) {
+            if (first) delimiter = line.find('\t') != string_view::npos ? '\t' : ',';
+            if (line.empty()) continue;
+            size_t count = splitFields(line, delimiter, fields);
+            if (!handle(fields, count) && !first) rejected++;
+            first = false;
+        }
+    }
+    
+public:
+    static Stats load(const string& directory, CityIndex& index, CityHeap& heap, RouteGraph& graph) {
+        Stats stats;
+        auto start = chrono::steady_clock::now();
+        string citiesPath = findFile(directory, "cities");
+        string hotelsPath = findFile(directory, "hotels");
+        string attractionsPath = findFile(directory, "attractions");
+        string routesPath = findFile(directory, "routes");
+        
+        size_t cityRows = citiesPath.empty() ? 0 : LineReader::countLines(citiesPath);
+        size_t routeRows = routesPath.empty() ? 0 : LineReader::countLines(routesPath);
+        heap.reserve(heap.size() + cityRows);
+        graph.reserve(graph.cityCount() + cityRows, routeRows);
+        
+        // Reused across rows so lookups need no fresh allocation
+        string key, otherKey;
+        
+        if (!citiesPath.empty()) {
+            forEachRow(citiesPath, stats.rejected, [&](const string_view* f, size_t n) {
+                double popularity, latitude, longitude;
+                if (n < 3 || !parseNumber(f[2], popularity)) return false;
+                // A repeated city would update the heap but not the index
+                key.assign(trim(f[0]));
+                if (index.findCity(key)) return false;
+                
+                City city(key, string(trim(f[1])), popularity);
+                if (n >= 5 && parseNumber(f[3], latitude) && parseNumber(f[4], longitude)) {
+                    city.setCoordinates(latitude, longitude);
+                    graph.setCityLocation(city.name, latitude, longitude);
+                }
+                index.insertCity(city);
+                heap.insertCity(city);
+                stats.cities++;
+                return true;
+            });
+        }
+        
+        if (!hotelsPath.empty()) {
+            forEachRow(hotelsPath, stats.rejected, [&](const string_view* f, size_t n) {
+                double rating;
+                int price;
+                if (n < 4 || !parseNumber(f[2], rating) || !parseNumber(f[3], price)) return false;
+                key.assign(trim(f[0]));
+                City* city = index.findCity(key);
+                if (!city) return false;
+                city->addHotel(Hotel(string(trim(f[1])), rating, price));
+                stats.hotels++;
+                return true;
+            });
+        }
+        
+        if (!attractionsPath.empty()) {
+            forEachRow(attractionsPath, stats.rejected, [&](const string_view* f, size_t n) {
+                double rating;
+                if (n < 4 || !parseNumber(f[2], rating)) return false;
+                key.assign(trim(f[0]));
+                City* city = index.findCity(key);
+                if (!city) return false;
+                city->addAttraction(Attraction(string(trim(f[1])), rating, string(trim(f[3]))));
+                stats.attractions++;
+                return true;
+            });
+        }
+        
+        if (!routesPath.empty()) {
+            forEachRow(routesPath, stats.rejected, [&](const string_view* f, size_t n) {
+                int distance;
+                if (n < 3 || !parseNumber(f[2], distance) || distance < 0) return false;
+                // Price, duration and mode are optional trailing columns
+                RouteAttributes route = RouteAttributes::byRoad(distance);
+                if (n > 3 && (!parseNumber(f[3], route.price) || route.price < 0)) return false;
+                if (n > 4 && (!parseNumber(f[4], route.duration) || route.duration < 0)) return false;
+                if (n > 5 && !RouteAttributes::parseMode(trim(f[5]), route.mode)) return false;
+                key.assign(trim(f[0]));
+                otherKey.assign(trim(f[1]));
+                if (key == otherKey) return false;
+                graph.addRoute(key, otherKey, route);
+                stats.routes++;
+                return true;
+            });
+        }
+        
+        graph.freeze();
+        stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        return stats;
+    }
+};
+
+// Durable trip persistence: a base file holding the full trip state and
+// an append-only log of the plan/complete/cancel operations made since.
+//
+//   <path>      "TPTRIPS 1 <generation>" then one line per trip:
+//               H (history, oldest first), F (upcoming, next first), T (all)
+//   <path>.log  "TPLOG 1 <generation>" then one operation per line
+//
+// Lines are tab-separated: kind, source, destination, distance, cost,
+// date, status; a reschedule record adds the new date as an 8th field.
+// Logged operations name the trip by its fields, not by scheduler ID.
+// Each append is synced before it returns; a record torn by a crash is
+// cut off the log on load, so the next append starts a fresh line.
+// save() compacts: it writes the whole state through one buffer to a
+// temporary file, renames it over the base file and starts a new log.
+// A log whose generation does not match the base file is left over from
+// an interrupted compaction and is ignored.
+class TripStore {
+public:
+    // Planner operations, plus the inverses logged when one is undone
+    enum class Op : char {
+        Plan = 'P', Complete = 'C', Cancel = 'X', Reschedule = 'R',
+        Unplan = 'U', Uncomplete = 'N', Restore = 'S'
+    };
+    
+    static bool isOp(char kind) {
+        return string_view("PCXRUNS").find(kind) != string_view::npos;
+    }
+    
+    struct State {
+        deque<Trip> history;
+        vector<Trip> upcoming;
+        vector<Trip> all;
+        
+        // Same trip regardless of status
+        static bool sameTrip(const Trip& a, const Trip& b) {
+            return a.source == b.source && a.destination == b.destination && a.day == b.day &&
+                   a.distance == b.distance && a.cost == b.cost;
+        }
+        
+        // Replay one logged operation the way the planner performed it;
+        // newDay is only used by Reschedule
+        void apply(Op op, const Trip& trip, int32_t newDay = 0) {
+            if (op == Op::Plan) {
+                upcoming.push_back(trip);
+                all.push_back(trip);
+                return;
+            }
+            auto match = [&](const Trip& other) { return sameTrip(trip, other); };
+            if (op == Op::Restore || op == Op::Uncomplete) {
+                if (op == Op::Uncomplete) {
+                    auto done = find_if(history.rbegin(), history.rend(), match);
+                    if (done != history.rend()) history.erase(next(done).base());
+                }
+                Trip planned = trip;
+                planned.status = TripStatus::Planned;
+                upcoming.push_back(planned);
+                return;
+            }
+            if (op == Op::Unplan) {
+                auto planned = find_if(all.rbegin(), all.rend(), match);
+                if (planned != all.rend()) all.erase(next(planned).base());
+            }
+            auto it = find_if(upcoming.begin(), upcoming.end(), match);
+            if (op == Op::Reschedule) {
+                if (it != upcoming.end()) it->day = newDay;
+                auto planned = find_if(all.begin(), all.end(), match);
+                if (planned != all.end()) planned->day = newDay;
+                return;
+            }
+            if (it != upcoming.end()) upcoming.erase(it);
+            if (op == Op::Complete) history.push_back(trip);
+        }
+    };
+    
+private:
+    string basePath;
+    uint64_t generation = 0;
+    bool baseValid = false;
+    FILE* log = nullptr;
+    size_t logRecords = 0;
+    vector<char> logBuffer;
+    
+    static constexpr size_t FIELD_COUNT = 7;
+    static constexpr size_t MAX_FIELDS = 8;
+    
+    static void appendField(string& out, const string& text) {
+        out += '\t';
+        for (char c : text) out += (c == '\t' || c == '\n' || c == '\r') ? ' ' : c;
+    }
+    
+    static void appendTrip(string& out, char kind, const Trip& trip, const CityInterner& names,
+                           const int32_t* newDay = nullptr) {
+        out += kind;
+        appendField(out, names.name(trip.source));
+        appendField(out, names.name(trip.destination));
+        out += '\t';
+        out += to_string(trip.distance);
+        out += '\t';
+        out += to_string(trip.cost);
+        out += '\t';
+        out += Trip::formatDate(trip.day);
+        out += '\t';
+        out += Trip::statusName(trip.status);
+        if (newDay) {
+            out += '\t';
+            out += Trip::formatDate(*newDay);
+        }
+        out += '\n';
+    }
+    
+    static bool parseTrip(string_view line, char& kind, Trip& trip, CityInterner& names, int32_t* newDay = nullptr) {
+        string_view fields[MAX_FIELDS];
+        size_t count = 0;
+        while (count < MAX_FIELDS) {
+            size_t cut = line.find('\t');
+            fields[count++] = line.substr(0, cut);
+            if (cut == string_view::npos) break;
+            line.remove_prefix(cut + 1);
+        }
+        if (count != (newDay ? MAX_FIELDS : FIELD_COUNT) || fields[0].size() != 1) return false;
+        if (newDay && !Trip::parseDate(fields[7], *newDay)) return false;
+        
+        auto number = [](string_view field, int32_t& value) {
+            auto result = from_chars(field.data(), field.data() + field.size(), value);
+            return result.ec == errc() && result.ptr == field.data() + field.size();
+        };
+        kind = fields[0][0];
+        if (!number(fields[3], trip.distance) || !number(fields[4], trip.cost) ||
+            !Trip::parseDate(fields[5], trip.day) || !Trip::parseStatus(fields[6], trip.status)) {
+            return false;
+        }
+        trip.source = names.intern(string(fields[1]));
+        trip.destination = names.intern(string(fields[2]));
+        return true;
+    }
+    
+    // "<tag> 1 <generation>" header line; returns false on a mismatch
+    static bool parseHeader(string_view line, string_view tag, uint64_t& gen) {
+        string prefix = string(tag) + " 1 ";
+        if (line.substr(0, prefix.size()) != prefix) return false;
+        line.remove_prefix(prefix.size());
+        auto result = from_chars(line.data(), line.data() + line.size(), gen);
+        return result.ec == errc() && result.ptr == line.data() + line.size();
+    }
+    
+    string logPath() const {
+        return basePath + ".log";
+    }
+    
+    void closeLog() {
+        if (log) fclose(log);
+        log = nullptr;
+    }
+    
+    // Truncate the log after its last newline, dropping a final record
+    // that a crash left half-written
+    void trimTornRecord() {
+        FILE* file = fopen(logPath().c_str(), "rb");
+        if (!file) return;
+        char block[4096];
+        fseeko(file, 0, SEEK_END);
+        off_t size = ftello(file), end = size, keep = 0;
+        while (end > 0 && keep == 0) {
+            size_t length = static_cast<size_t>(min<off_t>(sizeof(block), end));
+            end -= length;
+            fseeko(file, end, SEEK_SET);
+            if (fread(block, 1, length, file) != length) {
+                fclose(file);
+                return;
+            }
+            for (size_t i = length; i-- > 0;) {
+                if (block[i] == '\n') {
+                    keep = end + i + 1;
+                    break;
+                }
+            }
+        }
+        fclose(file);
+        if (keep != size) {
+            error_code error;
+            filesystem::resize_file(logPath(), keep, error);
+        }
+    }
+    
+public:
+    explicit TripStore(const string& path = "travel_data.txt") : basePath(path) {}
+    
+    ~TripStore() {
+        closeLog();
+    }
+    
+    TripStore(const TripStore&) = delete;
+    TripStore& operator=(const TripStore&) = delete;
+    
+    const string& path() const {
+        return basePath;
+    }
+    
+    void setPath(const string& path) {
+        closeLog();
+        basePath = path;
+        generation = 0;
+        baseValid = false;
+        logRecords = 0;
+    }
+    
+    // True once a base file has been loaded or written; the log only
+    // makes sense on top of one
+    bool hasBase() const {
+        return baseValid;
+    }
+    
+    // Operations logged since the last compaction
+    size_t pendingRecords() const {
+        return logRecords;
+    }
+    
+    // Read the base file and replay its log into state, interning city
+    // names into names. Returns false if there is no store at path or its
+    // base file is not in this format.
+    bool load(State& state, CityInterner& names) {
+        closeLog();
+        state = State();
+        logRecords = 0;
+        
+        LineReader base(basePath);
+        string_view line;
+        if (!base.isOpen() || !base.next(line) || !parseHeader(line, "TPTRIPS", generation)) {
+            generation = 0;
+            baseValid = false;
+            return false;
+        }
+        baseValid = true;
+        Trip trip;
+        char kind;
+        while (base.next(line)) {
+            if (!parseTrip(line, kind, trip, names)) continue;
+            if (kind == 'H') state.history.push_back(trip);
+            else if (kind == 'F') state.upcoming.push_back(trip);
+            else if (kind == 'T') state.all.push_back(trip);
+        }
+        
+        trimTornRecord();
+        LineReader journal(logPath());
+        uint64_t logGeneration;
+        if (journal.isOpen() && journal.next(line) && parseHeader(line, "TPLOG", logGeneration) &&
+            logGeneration == generation) {
+            while (journal.next(line)) {
+                bool reschedule = !line.empty() && line[0] == char(Op::Reschedule);
+                int32_t newDay = 0;
+                if (!parseTrip(line, kind, trip, names, reschedule ? &newDay : nullptr)) continue;
+                if (!isOp(kind)) continue;
+                state.apply(Op(kind), trip, newDay);
+                logRecords++;
+            }
+        }
+        return true;
+    }
+    
+    // Compact: write the full state crash-safely and start an empty log
+    template <typename History, typename Upcoming>
+    bool save(const CityInterner& names, const History& history, const Upcoming& upcoming, const vector<Trip>& all) {
+        string out;
+        out.reserve((history.size() + upcoming.size() + all.size()) * 48 + 32);
+        out += "TPTRIPS 1 " + to_string(generation + 1) + "\n";
+        for (const auto& trip : history) appendTrip(out, 'H', trip, names);
+        for (const auto& trip : upcoming) appendTrip(out, 'F', trip, names);
+        for (const auto& trip : all) appendTrip(out, 'T', trip, names);
+        
+        string temporary = basePath + ".tmp";
+        FILE* file = fopen(temporary.c_str(), "wb");
+        if (!file) return false;
+        bool written = fwrite(out.data(), 1, out.size(), file) == out.size();
+        written = fflush(file) == 0 && written;
+        written = fsync(fileno(file)) == 0 && written;
+        fclose(file);
+        if (!written || rename(temporary.c_str(), basePath.c_str()) != 0) {
+            remove(temporary.c_str());
+            return false;
+        }
+        
+        closeLog();
+        generation++;
+        baseValid = true;
+        logRecords = 0;
+        remove(logPath().c_str());
+        return true;
+    }
+    
+    // Append one operation to the log without rewriting the base file;
+    // a Reschedule logs the trip as it was plus its new day
+    bool append(Op op, const Trip& trip, const CityInterner& names, int32_t newDay = 0) {
+        if (!log) {
+            bool fresh = !filesystem::exists(logPath()) || logRecords == 0;
+            log = fopen(logPath().c_str(), fresh ? "wb" : "ab");
+            if (!log) return false;
+            logBuffer.resize(1 << 16);
+            setvbuf(log, logBuffer.data(), _IOFBF, logBuffer.size());
+            if (fresh) fprintf(log, "TPLOG 1 %llu\n", static_cast<unsigned long long>(generation));
+        }
+        string record;
+        appendTrip(record, char(op), trip, names, op == Op::Reschedule ? &newDay : nullptr);
+        bool written = fwrite(record.data(), 1, record.size(), log) == record.size() && fflush(log) == 0 &&
+                       fsync(fileno(log)) == 0;
+        if (written) {
+            logRecords++;
+        } else {
+            closeLog();
+            trimTornRecord(); // keep a partial write from merging with the next record
+        }
+        return written;
+    }
+};
+
+// Versioned, checksummed binary image of the catalog, laid out so that a
+// memory-mapped file can be queried in place. All sections are 8-byte
+// aligned arrays; strings are (offset, length) pairs into one table.
+//
+//   header | cities | nameOrder | ranking | csrOffsets | csrTargets |
+//   csrWeights | csrRoutes | hotels | attractions | strings
+//
+// City IDs are the RouteGraph node IDs, followed by cities that have no
+// routes; csrRoutes holds each CSR slot's price, duration and mode. The
+// checksum is FNV-1a over everything after the header.
+namespace catalog_snapshot {
+    const char MAGIC[8] = {'T', 'P', 'S', 'N', 'A', 'P', '\0', '\0'};
+    const uint32_t VERSION = 2;
+    
+    struct Section {
+        uint64_t offset;
+        uint64_t count;
+    };
+    
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t fileSize;
+        uint64_t checksum;
+        Section cities, nameOrder, ranking, csrOffsets, csrTargets, csrWeights, csrRoutes, hotels, attractions, strings;
+    };
+    
+    struct StringRef {
+        uint32_t offset;
+        uint32_t length;
+    };
+    
+    struct CityRecord {
+        StringRef name;
+        StringRef country;
+        double popularity;   // NaN for route-only nodes without city data
+        double latitude;
+        double longitude;
+        uint32_t firstHotel, hotelCount;
+        uint32_t firstAttraction, attractionCount;
+    };
+    
+    struct RouteRecord {
+        int32_t price;
+        int32_t duration;
+        uint32_t mode;       // a TravelMode
+    };
+    
+    struct HotelRecord {
+        StringRef name;
+        double rating;
+        int32_t pricePerNight;
+        uint32_t reserved;
+    };
+    
+    struct AttractionRecord {
+        StringRef name;
+        StringRef type;
+        double rating;
+    };
+    
+    static_assert(sizeof(CityRecord) == 56 && sizeof(RouteRecord) == 12 && sizeof(HotelRecord) == 24 &&
+                  sizeof(AttractionRecord) == 24,
+                  "snapshot records must keep their on-disk size");
+    
+    inline uint64_t checksum(const char* data, size_t size) {
+        uint64_t hash = 1469598103934665603ULL;
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ULL;
+        }
+        return hash;
+    }
+}
+
+// Builds a catalog snapshot and writes it via a temporary file + rename
+class SnapshotWriter {
+private:
+    vector<char> strings;
+    
+    catalog_snapshot::StringRef addString(const string& text) {
+        catalog_snapshot::StringRef ref = {static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(text.size())};
+        strings.insert(strings.end(), text.begin(), text.end());
+        return ref;
+    }
+    
+    template <typename T>
+    static catalog_snapshot::Section append(vector<char>& image, const T* data, size_t count) {
+        image.resize((image.size() + 7) & ~size_t(7), 0);
+        catalog_snapshot::Section section = {image.size(), count};
+        const char* bytes = reinterpret_cast<const char*>(data);
+        image.insert(image.end(), bytes, bytes + count * sizeof(T));
+        return section;
+    }
+    
+public:
+    bool write(const string& filename, const CityIndex& index, const CityHeap& heap, const RouteGraph& graph) {
+        using namespace catalog_snapshot;
+        strings.clear();
+        const CSRGraph& csr = graph.adjacency();
+        
+        // Route nodes keep their IDs; cities without routes follow
+        vector<const City*> cityData(graph.cityCount(), nullptr);
+        vector<string> extraNames;
+        index.forEachCity([&](const City& city) {
+            uint32_t id = graph.cityId(city.name);
+            if (id == CityInterner::INVALID_ID) {
+                cityData.push_back(&city);
+            } else {
+                cityData[id] = &city;
+            }
+        });
+        uint32_t cityCount = cityData.size();
+        
+        vector<CityRecord> cities(cityCount);
+        vector<HotelRecord> hotels;
+        vector<AttractionRecord> attractions;
+        for (uint32_t id = 0; id < cityCount; id++) {
+            const City* city = cityData[id];
+            CityRecord& record = cities[id];
+            if (!city) {
+                record.name = addString(graph.cityName(id));
+                record.country = addString("");
+                record.popularity = record.latitude = record.longitude = NAN;
+                record.firstHotel = record.firstAttraction = 0;
+                record.hotelCount = record.attractionCount = 0;
+                continue;
+            }
+            
+            double ranked = heap.popularityOf(city->name);
+            record.name = addString(city->name);
+            record.country = addString(city->country);
+            record.popularity = std::isnan(ranked) ? city->popularity : ranked;
+            record.latitude = city->latitude;
+            record.longitude = city->longitude;
+            record.firstHotel = hotels.size();
+            record.hotelCount = city->hotels.size();
+            for (const auto& hotel : city->hotels) {
+                hotels.push_back({addString(hotel.name), hotel.rating, hotel.pricePerNight, 0});
+            }
+            record.firstAttraction = attractions.size();
+            record.attractionCount = city->attractions.size();
+            for (const auto& attraction : city->attractions) {
+                attractions.push_back({addString(attraction.name), addString(attraction.type), attraction.rating});
+            }
+        }
+        
+        auto nameOf = [&](uint32_t id) {
+            return string_view(strings.data() + cities[id].name.offset, cities[id].name.length);
+        };
+        vector<uint32_t> nameOrder(cityCount), ranking;
+        for (uint32_t id = 0; id < cityCount; id++) nameOrder[id] = id;
+        sort(nameOrder.begin(), nameOrder.end(), [&](uint32_t a, uint32_t b) { return nameOf(a) < nameOf(b); });
+        for (uint32_t id = 0; id < cityCount; id++) {
+            if (!std::isnan(cities[id].popularity)) ranking.push_back(id);
+        }
+        stable_sort(ranking.begin(), ranking.end(), [&](uint32_t a, uint32_t b) {
+            return cities[a].popularity > cities[b].popularity;
+        });
+        
+        // Nodes without routes get empty adjacency ranges
+        vector<uint32_t> offsets(csr.offsets);
+        offsets.resize(cityCount + 1, csr.targets.size());
+        vector<RouteRecord> routes;
+        routes.reserve(csr.targets.size());
+        for (const RouteAttributes& route : graph.adjacencyRoutes()) {
+            routes.push_back({route.price, route.duration, static_cast<uint32_t>(route.mode)});
+        }
+        
+        vector<char> image(sizeof(Header), 0);
+        Header header = {};
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.cities = append(image, cities.data(), cities.size());
+        header.nameOrder = append(image, nameOrder.data(), nameOrder.size());
+        header.ranking = append(image, ranking.data(), ranking.size());
+        header.csrOffsets = append(image, offsets.data(), offsets.size());
+        header.csrTargets = append(image, csr.targets.data(), csr.targets.size());
+        header.csrWeights = append(image, csr.weights.data(), csr.weights.size());
+        header.csrRoutes = append(image, routes.data(), routes.size());
+        header.hotels = append(image, hotels.data(), hotels.size());
+        header.attractions = append(image, attractions.data(), attractions.size());
+        header.strings = append(image, strings.data(), strings.size());
+        header.fileSize = image.size();
+        header.checksum = checksum(image.data() + sizeof(Header), image.size() - sizeof(Header));
+        memcpy(image.data(), &header, sizeof(Header));
+        
+        // Flushed, synced and closed before the rename, as in TripStore
+        string temporary = filename + ".tmp";
+        FILE* file = fopen(temporary.c_str(), "wb");
+        if (!file) return false;
+        bool written = fwrite(image.data(), 1, image.size(), file) == image.size();
+        written = fflush(file) == 0 && written;
+        written = fsync(fileno(file)) == 0 && written;
+        written = fclose(file) == 0 && written;
+        if (!written || rename(temporary.c_str(), filename.c_str()) != 0) {
+            remove(temporary.c_str());
+            return false;
+        }
+        return true;
+    }
+};
+
+// Read-only catalog served straight from a memory-mapped snapshot file
+class MappedSnapshot {
+private:
+    const char* base = nullptr;
+    size_t length = 0;
+    const catalog_snapshot::Header* header = nullptr;
+    
+    template <typename T>
+    const T* section(const catalog_snapshot::Section& s) const {
+        return reinterpret_cast<const T*>(base + s.offset);
+    }
+    
+    template <typename T>
+    bool sectionFits(const catalog_snapshot::Section& s) const {
+        return s.offset % 8 == 0 && s.offset <= length && s.count <= (length - s.offset) / sizeof(T);
+    }
+    
+    // Structural checks on a mapped file whose sections fit: CSR offsets
+    // are monotonic, every ID, string and hotel/attraction range stays
+    // inside its section, so no query reads outside the mapping
+    bool consistent() const {
+        using namespace catalog_snapshot;
+        uint64_t n = header->cities.count;
+        uint64_t stringBytes = header->strings.count;
+        auto textFits = [stringBytes](const StringRef& ref) {
+            return static_cast<uint64_t>(ref.offset) + ref.length <= stringBytes;
+        };
+        auto idsFit = [n](const uint32_t* ids, uint64_t count) {
+            return all_of(ids, ids + count, [n](uint32_t id) { return id < n; });
+        };
+        if (!idsFit(section<uint32_t>(header->nameOrder), header->nameOrder.count) ||
+            !idsFit(section<uint32_t>(header->ranking), header->ranking.count) ||
+            !idsFit(section<uint32_t>(header->csrTargets), header->csrTargets.count)) {
+            return false;
+        }
+        
+        const uint32_t* offsets = section<uint32_t>(header->csrOffsets);
+        if (offsets[0] != 0 || offsets[n] != header->csrTargets.count) return false;
+        for (uint64_t u = 0; u < n; u++) {
+            if (offsets[u] > offsets[u + 1]) return false;
+        }
+        const int* weights = section<int>(header->csrWeights);
+        const RouteRecord* records = section<RouteRecord>(header->csrRoutes);
+        for (uint64_t e = 0; e < header->csrTargets.count; e++) {
+            if (weights[e] < 0 || records[e].mode > static_cast<uint32_t>(TravelMode::Ferry)) return false;
+        }
+        
+        const CityRecord* cities = section<CityRecord>(header->cities);
+        for (uint64_t id = 0; id < n; id++) {
+            const CityRecord& c = cities[id];
+            if (!textFits(c.name) || !textFits(c.country) ||
+                static_cast<uint64_t>(c.firstHotel) + c.hotelCount > header->hotels.count ||
+                static_cast<uint64_t>(c.firstAttraction) + c.attractionCount > header->attractions.count) {
+                return false;
+            }
+        }
+        const HotelRecord* hotelRecords = section<HotelRecord>(header->hotels);
+        for (uint64_t i = 0; i < header->hotels.count; i++) {
+            if (!textFits(hotelRecords[i].name)) return false;
+        }
+        const AttractionRecord* attractionRecords = section<AttractionRecord>(header->attractions);
+        for (uint64_t i = 0; i < header->attractions.count; i++) {
+            if (!textFits(attractionRecords[i].name) || !textFits(attractionRecords[i].type)) return false;
+        }
+        return true;
+    }
+    
+    void unmap() {
+        if (base) munmap(const_cast<char*>(base), length);
+        base = nullptr;
+        header = nullptr;
+        length = 0;
+    }
+    
+public:
+    typedef catalog_snapshot::CityRecord CityRecord;
+    typedef catalog_snapshot::RouteRecord RouteRecord;
+    typedef catalog_snapshot::HotelRecord HotelRecord;
+    typedef catalog_snapshot::AttractionRecord AttractionRecord;
+    
+    MappedSnapshot() = default;
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+    
+    ~MappedSnapshot() {
+        unmap();
+    }
+    
+    // Map filename and validate its layout; verifyChecksum reads every page
+    bool open(const string& filename, bool verifyChecksum = true) {
+        using namespace catalog_snapshot;
+        unmap();
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+            close(fd);
+            return false;
+        }
+        void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) return false;
+        base = static_cast<const char*>(mapped);
+        length = info.st_size;
+        header = reinterpret_cast<const Header*>(base);
+        
+        bool valid = memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 && header->version == VERSION &&
+                     header->fileSize == length &&
+                     sectionFits<CityRecord>(header->cities) && sectionFits<uint32_t>(header->nameOrder) &&
+                     sectionFits<uint32_t>(header->ranking) && sectionFits<uint32_t>(header->csrOffsets) &&
+                     sectionFits<uint32_t>(header->csrTargets) && sectionFits<int>(header->csrWeights) &&
+                     sectionFits<RouteRecord>(header->csrRoutes) &&
+                     sectionFits<HotelRecord>(header->hotels) && sectionFits<AttractionRecord>(header->attractions) &&
+                     sectionFits<char>(header->strings) &&
+                     header->nameOrder.count == header->cities.count &&
+                     header->csrOffsets.count == header->cities.count + 1 &&
+                     header->csrWeights.count == header->csrTargets.count &&
+                     header->csrRoutes.count == header->csrTargets.count;
+        if (valid && verifyChecksum) {
+            valid = checksum(base + sizeof(Header), length - sizeof(Header)) == header->checksum;
+        }
+        valid = valid && consistent();
+        if (!valid) unmap();
+        return valid;
+    }
+    
+    bool isOpen() const {
+        return base != nullptr;
+    }
+    
+    uint32_t cityCount() const {
+        return header->cities.count;
+    }
+    
+    const CityRecord& city(uint32_t id) const {
+        return section<CityRecord>(header->cities)[id];
+    }
+    
+    string_view text(const catalog_snapshot::StringRef& ref) const {
+        return string_view(section<char>(header->strings) + ref.offset, ref.length);
+    }
+    
+    string_view cityName(uint32_t id) const {
+        return text(city(id).name);
+    }
+    
+    // True for entries that carry hotel/attraction data, not just routes
+    bool hasCityData(uint32_t id) const {
+        return !std::isnan(city(id).popularity);
+    }
+    
+    ArrayView<HotelRecord> hotels(uint32_t id) const {
+        return ArrayView<HotelRecord>(section<HotelRecord>(header->hotels) + city(id).firstHotel, city(id).hotelCount);
+    }
+    
+    ArrayView<AttractionRecord> attractions(uint32_t id) const {
+        return ArrayView<AttractionRecord>(section<AttractionRecord>(header->attractions) + city(id).firstAttraction,
+                                           city(id).attractionCount);
+    }
+    
+    // Binary search over the name-ordered ID array
+    uint32_t findCity(string_view name) const {
+        const uint32_t* order = section<uint32_t>(header->nameOrder);
+        const uint32_t* end = order + header->nameOrder.count;
+        const uint32_t* it = lower_bound(order, end, name, [this](uint32_t id, string_view key) {
+            return cityName(id) < key;
+        });
+        return it != end && cityName(*it) == name ? *it : CityInterner::INVALID_ID;
+    }
+    
+    // City IDs from most to least popular
+    ArrayView<uint32_t> ranking() const {
+        return ArrayView<uint32_t>(section<uint32_t>(header->ranking), header->ranking.count);
+    }
+    
+    CSRView routes() const {
+        return {section<uint32_t>(header->csrOffsets), section<uint32_t>(header->csrTargets),
+                section<int>(header->csrWeights), cityCount()};
+    }
+    
+    // Dijkstra over the mapped CSR arrays
+    pair<int, vector<string>> findShortestPath(const string& source, const string& destination) const {
+        vector<string> path;
+        uint32_t src = findCity(source);
+        uint32_t dst = findCity(destination);
+        if (src == CityInterner::INVALID_ID || dst == CityInterner::INVALID_ID) {
+            return {-1, path};
+        }
+        
+        QueryWorkspace& ws = QueryWorkspace::local();
+        vector<uint32_t>& idPath = ws.path;
+        SearchStats stats;
+        int distance = dijkstraSearch(routes(), src, dst, idPath, stats, ws);
+        for (uint32_t id : idPath) {
+            path.push_back(string(cityName(id)));
+        }
+        return {distance, path};
+    }
+    
+    // Per-leg distance, price, duration and mode of a path of city names,
+    // taking the shortest route between consecutive cities, as
+    // RouteGraph::describePath
+    bool describePath(const vector<string>& path, RoutePlan& plan) const {
+        plan = RoutePlan();
+        plan.path = path;
+        CSRView graph = routes();
+        const RouteRecord* records = section<RouteRecord>(header->csrRoutes);
+        for (size_t i = 0; i + 1 < path.size(); i++) {
+            uint32_t u = findCity(path[i]);
+            uint32_t v = findCity(path[i + 1]);
+            if (u == CityInterner::INVALID_ID || v == CityInterner::INVALID_ID) return false;
+            
+            uint32_t best = UINT32_MAX;
+            for (uint32_t e = graph.offsets[u]; e < graph.offsets[u + 1]; e++) {
+                if (graph.targets[e] == v && (best == UINT32_MAX || graph.weights[e] < graph.weights[best])) best = e;
+            }
+            if (best == UINT32_MAX) return false;
+            
+            plan.distance += graph.weights[best];
+            plan.price += records[best].price;
+            plan.duration += records[best].duration;
+            plan.legs++;
+            plan.modes.push_back(static_cast<TravelMode>(records[best].mode));
+        }
+        return true;
+    }
+    
+    // Bounded one-to-all search over the mapped CSR arrays, as
+    // RouteGraph::forEachWithinAny; visit gets string_views into the map
+    template <typename Visitor>
+    void forEachWithinAny(const vector<string>& sources, int maxDistance, Visitor visit) const {
+        vector<uint32_t> ids;
+        for (const string& source : sources) {
+            uint32_t id = findCity(source);
+            if (id != CityInterner::INVALID_ID) ids.push_back(id);
+        }
+        if (ids.empty()) return;
+        boundedSearch(routes(), ids, maxDistance, QueryWorkspace::local(),
+                      [&](uint32_t id, int distance, uint32_t origin) {
+            return visit(cityName(id), distance, cityName(origin));
+        });
+    }
+    
+    void displayCity(uint32_t id) const {
+        const CityRecord& record = city(id);
+        cout << "\n=== " << text(record.name) << ", " << text(record.country) << " ===\n";
+        cout << "Popularity Score: " << record.popularity << "\n";
+        
+        cout << "\nTop Hotels:\n";
+        for (const auto& hotel : hotels(id)) {
+            cout << "  - " << text(hotel.name) << " (Rating: " << hotel.rating
+                 << ", $" << hotel.pricePerNight << "/night)\n";
+        }
+        
+        cout << "\nTop Attractions:\n";
+        for (const auto& attraction : attractions(id)) {
+            cout << "  - " << text(attraction.name) << " (" << text(attraction.type)
+                 << ", Rating: " << attraction.rating << ")\n";
+        }
+    }
+};
+
+// The planner's city catalog. Held through a shared_ptr so an import can
+// build a new catalog and undo can switch back to the previous one.
+struct PlannerCatalog {
+    RouteGraph routeGraph;
+    CityIndex cityDatabase;
+    CityHeap popularDestinations;
+    
+    PlannerCatalog() = default;
+    
+    // Copy of another catalog; the B-tree index is rebuilt in order
+    explicit PlannerCatalog(const PlannerCatalog& other)
+        : routeGraph(other.routeGraph), popularDestinations(other.popularDestinations) {
+        other.cityDatabase.forEachCity([this](const City& city) { cityDatabase.insertCity(city); });
+    }
+};
+
+// One undoable planner operation. Trip commands remember the scheduler
+// ID the trip had; undo and redo run in strict LIFO order, so the
+// scheduler's ID free list hands the same ID back when a trip returns.
+struct PlannerCommand {
+    enum class Kind : uint8_t { Plan, Complete, Cancel, Reschedule, Import };
+    
+    Kind kind;
+    Trip trip;                          // as planned, completed or cancelled
+    uint32_t tripId = TripScheduler::INVALID_ID;
+    int32_t otherDay = 0;               // Reschedule: the day it moved to
+    shared_ptr<PlannerCatalog> catalog; // Import: the catalog to switch to
+};
+
+// Saves a stream's flags and precision and puts them back on restore()
+// or at scope exit, so fixed-point figures do not change later output
+class StreamFormatGuard {
+private:
+    ostream& stream;
+    ios::fmtflags flags;
+    streamsize precision;
+    
+public:
+    explicit StreamFormatGuard(ostream& out = cout) : stream(out), flags(out.flags()), precision(out.precision()) {}
+    
+    ~StreamFormatGuard() {
+        restore();
+    }
+    
+    StreamFormatGuard(const StreamFormatGuard&) = delete;
+    StreamFormatGuard& operator=(const StreamFormatGuard&) = delete;
+    
+    void restore() {
+        stream.flags(flags);
+        stream.precision(precision);
+    }
+};
+
+// Main Travel Planner Manager class
+class TravelPlannerManager {
+private:
+    shared_ptr<PlannerCatalog> catalog = make_shared<PlannerCatalog>();
+    PersistentStack<Trip> travelHistory;   // most recent first
+    TripScheduler futureTrips;
+    vector<Trip> allTrips;
+    CityInterner tripCities;   // names behind Trip::source/destination
+    TripStore tripStore;
+    TripColumns tripTable;     // rebuilt for reports when reportsStale
+    bool reportsStale = true;
+    MappedSnapshot snapshot;
+    QueryEngine queryEngine;   // route queries read its published catalog
+    vector<PlannerCommand> undoLog;
+    vector<PlannerCommand> redoLog;
+    
+    static constexpr size_t COMPACT_EVERY = 1024;   // logged operations
+    static constexpr size_t HISTORY_PAGE = 5;
+    static constexpr size_t ALTERNATIVE_ROUTES = 5;
+    
+    // Build a trip from display values, interning its city names
+    Trip makeTrip(const string& source, const string& destination, int distance, int cost,
+                  const string& date, TripStatus status) {
+        int32_t day = 0;
+        Trip::parseDate(date, day);
+        return Trip(tripCities.intern(source), tripCities.intern(destination), distance, cost, day, status);
+    }
+    
+    // Split "Paris, Rome , Tokyo" into trimmed, non-empty city names
+    static vector<string> splitCityList(const string& line) {
+        vector<string> names;
+        for (size_t start = 0; start <= line.size();) {
+            size_t comma = min(line.find(',', start), line.size());
+            size_t first = line.find_first_not_of(" \t", start);
+            if (first < comma) {
+                names.push_back(line.substr(first, line.find_last_not_of(" \t", comma - 1) - first + 1));
+            }
+            start = comma + 1;
+        }
+        return names;
+    }
+    
+    // Publish the catalog's routes and cities for route queries; called
+    // after the catalog's cities change
+    void publishCatalog() {
+        vector<City> cities;
+        catalog->cityDatabase.forEachCity([&cities](const City& city) { cities.push_back(city); });
+        queryEngine.publish(catalog->routeGraph, move(cities));
+    }
+    
+    // Publish only the routes, after a route edit or new preprocessing;
+    // the published cities are shared with the previous version
+    void publishRoutes() {
+        queryEngine.publish(catalog->routeGraph);
+    }
+    
+    // Record a new command; it invalidates anything that could be redone
+    void pushCommand(const PlannerCommand& command) {
+        undoLog.push_back(command);
+        redoLog.clear();
+    }
+    
+    // Perform a trip command and make it undoable
+    void execute(PlannerCommand::Kind kind, const Trip& trip, uint32_t tripId, int32_t otherDay = 0) {
+        PlannerCommand command;
+        command.kind = kind;
+        command.trip = trip;
+        command.tripId = tripId;
+        command.otherDay = otherDay;
+        runCommand(command, true);
+        pushCommand(command);
+    }
+    
+    // Remove the most recent allTrips entry for trip
+    void forgetPlannedTrip(const Trip& trip) {
+        for (size_t i = allTrips.size(); i-- > 0;) {
+            if (TripStore::State::sameTrip(allTrips[i], trip)) {
+                allTrips.erase(allTrips.begin() + i);
+                return;
+            }
+        }
+    }
+    
+    // Move the first allTrips entry for trip to another day
+    void movePlannedTrip(const Trip& trip, int32_t day) {
+        for (auto& planned : allTrips) {
+            if (TripStore::State::sameTrip(planned, trip)) {
+                planned.day = day;
+                return;
+            }
+        }
+    }
+    
+    // Apply command forward (redo) or backward (undo); trip commands are
+    // logged to the trip store like the original operations
+    void runCommand(PlannerCommand& command, bool forward) {
+        Trip planned = command.trip;
+        planned.status = TripStatus::Planned;
+        switch (command.kind) {
+            case PlannerCommand::Kind::Plan:
+                if (forward) {
+                    command.tripId = futureTrips.schedule(command.trip);
+                    allTrips.push_back(command.trip);
+                    recordTrip(TripStore::Op::Plan, command.trip);
+                } else {
+                    futureTrips.cancel(command.tripId);
+                    forgetPlannedTrip(command.trip);
+                    recordTrip(TripStore::Op::Unplan, command.trip);
+                }
+                break;
+                
+            case PlannerCommand::Kind::Complete:
+                if (forward) {
+                    futureTrips.cancel(command.tripId);
+                    travelHistory = travelHistory.push(command.trip);
+                    recordTrip(TripStore::Op::Complete, command.trip);
+                } else {
+                    travelHistory = travelHistory.pop();
+                    command.tripId = futureTrips.schedule(planned);
+                    recordTrip(TripStore::Op::Uncomplete, command.trip);
+                }
+                break;
+                
+            case PlannerCommand::Kind::Cancel:
+                if (forward) {
+                    futureTrips.cancel(command.tripId);
+                    recordTrip(TripStore::Op::Cancel, command.trip);
+                } else {
+                    command.tripId = futureTrips.schedule(command.trip);
+                    recordTrip(TripStore::Op::Restore, command.trip);
+                }
+                break;
+                
+            case PlannerCommand::Kind::Reschedule: {
+                Trip from = command.trip;
+                int32_t to = command.otherDay;
+                if (!forward) {
+                    swap(from.day, to);
+                }
+                futureTrips.reschedule(command.tripId, to);
+                movePlannedTrip(from, to);
+                recordTrip(TripStore::Op::Reschedule, from, to);
+                break;
+            }
+                
+            case PlannerCommand::Kind::Import:
+                swap(catalog, command.catalog);
+                publishCatalog();
+                break;
+        }
+    }
+    
+    static string describe(const PlannerCommand& command, const CityInterner& names) {
+        static const char* verbs[] = {"plan", "complete", "cancel", "reschedule", "import of"};
+        string text = verbs[static_cast<size_t>(command.kind)];
+        if (command.kind == PlannerCommand::Kind::Import) {
+            return text + " catalog";
+        }
+        return text + " " + names.name(command.trip.source) + " -> " + names.name(command.trip.destination) +
+               " (" + Trip::formatDate(command.trip.day) + ")";
+    }
+    
+    // Log a trip operation, compacting the store once the log grows
+    void recordTrip(TripStore::Op op, const Trip& trip, int32_t newDay = 0) {
+        reportsStale = true;
+        if (!tripStore.hasBase() || tripStore.pendingRecords() >= COMPACT_EVERY) {
+            saveTrips();
+        } else if (!tripStore.append(op, trip, tripCities, newDay)) {
+            cout << "Warning: could not log trip to " << tripStore.path() << ".log\n";
+        }
+    }
+
+public:
+    // Constructor - Initialize with sample data unless a snapshot follows
+    TravelPlannerManager(bool loadSampleData = true) {
+        catalog->routeGraph.enableRouteCache();
+        if (loadSampleData) {
+            initializeSampleData();
+        }
+    }
+    
+    // Initialize sample cities and routes
+    void initializeSampleData() {
+        // Create sample cities
+        City paris("Paris", "France", 9.5);
+        paris.addHotel(Hotel("Hotel Ritz", 4.8, 500));
+        paris.addHotel(Hotel("Ibis Budget", 4.2, 80));
+        paris.addAttraction(Attraction("Eiffel Tower", 4.9, "Monument"));
+        paris.addAttraction(Attraction("Louvre Museum", 4.7, "Museum"));
+        
+        City london("London", "UK", 9.2);
+        london.addHotel(Hotel("The Savoy", 4.9, 600));
+        london.addHotel(Hotel("Premier Inn", 4.3, 90));
+        london.addAttraction(Attraction("Big Ben", 4.6, "Monument"));
+        london.addAttraction(Attraction("British Museum", 4.8, "Museum"));
+        
+        City rome("Rome", "Italy", 8.8);
+        rome.addHotel(Hotel("Hotel Eden", 4.7, 400));
+        rome.addHotel(Hotel("B&B Rome", 4.1, 70));
+        rome.addAttraction(Attraction("Colosseum", 4.9, "Historical"));
+        rome.addAttraction(Attraction("Vatican City", 4.8, "Religious"));
+        
+        City tokyo("Tokyo", "Japan", 9.0);
+        tokyo.addHotel(Hotel("Park Hyatt", 4.8, 450));
+        tokyo.addHotel(Hotel("Capsule Hotel", 4.0, 40));
+        tokyo.addAttraction(Attraction("Tokyo Tower", 4.5, "Monument"));
+        tokyo.addAttraction(Attraction("Senso-ji Temple", 4.6, "Religious"));
+        
+        City newyork("New York", "USA", 9.3);
+        newyork.addHotel(Hotel("The Plaza", 4.6, 550));
+        newyork.addHotel(Hotel("YMCA", 3.8, 100));
+        newyork.addAttraction(Attraction("Statue of Liberty", 4.7, "Monument"));
+        newyork.addAttraction(Attraction("Central Park", 4.8, "Park"));
+        
+        paris.setCoordinates(48.8566, 2.3522);
+        london.setCoordinates(51.5074, -0.1278);
+        rome.setCoordinates(41.9028, 12.4964);
+        tokyo.setCoordinates(35.6762, 139.6503);
+        newyork.setCoordinates(40.7128, -74.0060);
+        
+        // Add cities to the index and heap
+        catalog->cityDatabase.insertCity(paris);
+        catalog->cityDatabase.insertCity(london);
+        catalog->cityDatabase.insertCity(rome);
+        catalog->cityDatabase.insertCity(tokyo);
+        catalog->cityDatabase.insertCity(newyork);
+        
+        catalog->popularDestinations.insertCity(paris);
+        catalog->popularDestinations.insertCity(london);
+        catalog->popularDestinations.insertCity(rome);
+        catalog->popularDestinations.insertCity(tokyo);
+        catalog->popularDestinations.insertCity(newyork);
+        
+        // Add routes between cities (distance in km)
+        // Routes as (distance km, price $, duration min, mode)
+        catalog->routeGraph.addRoute("Paris", "London", {344, 95, 140, TravelMode::Rail});
+        catalog->routeGraph.addRoute("Paris", "London", {460, 35, 480, TravelMode::Road});
+        catalog->routeGraph.addRoute("Paris", "Rome", {1105, 120, 130, TravelMode::Air});
+        catalog->routeGraph.addRoute("Paris", "Rome", {1420, 80, 660, TravelMode::Rail});
+        catalog->routeGraph.addRoute("London", "Rome", {1435, 110, 165, TravelMode::Air});
+        catalog->routeGraph.addRoute("Paris", "New York", {5837, 550, 510, TravelMode::Air});
+        catalog->routeGraph.addRoute("London", "New York", {5585, 430, 480, TravelMode::Air});
+        catalog->routeGraph.addRoute("Rome", "New York", {6905, 620, 600, TravelMode::Air});
+        catalog->routeGraph.addRoute("Tokyo", "New York", {10838, 900, 780, TravelMode::Air});
+        catalog->routeGraph.addRoute("Paris", "Tokyo", {9714, 1050, 840, TravelMode::Air});
+        catalog->routeGraph.addRoute("London", "Tokyo", {9560, 880, 830, TravelMode::Air});
+        
+        for (const City* city : {&paris, &london, &rome, &tokyo, &newyork}) {
+            catalog->routeGraph.setCityLocation(city->name, city->latitude, city->longitude);
+        }
+        publishCatalog();
+        
+        // Add some sample completed trips to history
+        travelHistory = travelHistory.push(makeTrip("Paris", "London", 344, 200, "2024-01-15", TripStatus::Completed));
+        travelHistory = travelHistory.push(makeTrip("London", "Rome", 1435, 350, "2024-02-20", TripStatus::Completed));
+        
+        // Add sample future trips
+        for (const Trip& trip : {makeTrip("Rome", "Tokyo", 9714, 800, "2024-08-15", TripStatus::Planned),
+                                 makeTrip("Tokyo", "New York", 10838, 1200, "2024-09-01", TripStatus::Planned)}) {
+            futureTrips.schedule(trip);
+            allTrips.push_back(trip);
+        }
+    }
+    
+    // Bulk-load cities, hotels, attractions and routes from a directory
+    // into a copy of the catalog, so the import can be undone
+    bool importCatalog(const string& directory) {
+        auto imported = make_shared<PlannerCatalog>(*catalog);
+        CatalogImporter::Stats stats = CatalogImporter::load(directory, imported->cityDatabase,
+                                                             imported->popularDestinations, imported->routeGraph);
+        if (stats.rows() == 0) {
+            cout << "No catalog data found in " << directory << "\n";
+            return false;
+        }
+        
+        PlannerCommand command;
+        command.kind = PlannerCommand::Kind::Import;
+        command.catalog = catalog;
+        pushCommand(command);
+        catalog = imported;
+        publishCatalog();
+        
+        StreamFormatGuard format;
+        cout << "Imported " << stats.cities << " cities, " << stats.hotels << " hotels, "
+             << stats.attractions << " attractions and " << stats.routes << " routes in "
+             << fixed << setprecision(2) << stats.seconds << "s";
+        format.restore();
+        if (stats.rejected > 0) {
+            cout << " (" << stats.rejected << " rows rejected)";
+        }
+        cout << "\n";
+        return true;
+    }
+    
+    // Load the route hierarchy from path, or contract the graph and save it
+    void enableContractionHierarchy(const string& path) {
+        if (catalog->routeGraph.loadContractionHierarchy(path)) {
+            publishRoutes();
+            cout << "Loaded contraction hierarchy from " << path << "\n";
+            return;
+        }
+        
+        catalog->routeGraph.buildContractionHierarchy();
+        publishRoutes();
+        cout << "Built contraction hierarchy (" << catalog->routeGraph.hierarchyShortcuts() << " shortcuts)";
+        if (catalog->routeGraph.saveContractionHierarchy(path)) {
+            cout << ", saved to " << path;
+        }
+        cout << "\n";
+    }
+    
+    // Load the landmark table from path, or compute it and save it
+    void enableLandmarks(const string& path) {
+        if (catalog->routeGraph.loadLandmarks(path)) {
+            publishRoutes();
+            cout << "Loaded landmarks from " << path << "\n";
+            return;
+        }
+        
+        catalog->routeGraph.buildLandmarks();
+        publishRoutes();
+        const LandmarkTable* table = catalog->routeGraph.landmarkTable();
+        cout << "Computed " << table->count() << " landmarks (" << table->bytes() / 1024 << " KB)";
+        if (catalog->routeGraph.saveLandmarks(path)) {
+            cout << ", saved to " << path;
+        }
+        cout << "\n";
+    }
+    
+    // Restore trips saved at path, replacing the in-memory trip state
+    bool loadTrips(const string& path) {
+        tripStore.setPath(path);
+        TripStore::State state;
+        if (!tripStore.load(state, tripCities)) {
+            return false;
+        }
+        
+        size_t count = state.all.size();
+        travelHistory = PersistentStack<Trip>();
+        for (const auto& trip : state.history) travelHistory = travelHistory.push(trip);
+        undoLog.clear();
+        redoLog.clear();
+        futureTrips.clear();
+        futureTrips.reserve(state.upcoming.size());
+        for (const auto& trip : state.upcoming) futureTrips.schedule(trip);
+        allTrips = move(state.all);
+        reportsStale = true;
+        cout << "Loaded " << count << " trips from " << path << "\n";
+        return true;
+    }
+    
+    // Compact all trips into the store's base file
+    bool saveTrips() {
+        vector<Trip> history(travelHistory.begin(), travelHistory.end());
+        reverse(history.begin(), history.end());
+        if (!tripStore.save(tripCities, history, futureTrips.ordered(), allTrips)) {
+            cout << "Error: Could not save trips to " << tripStore.path() << "\n";
+            return false;
+        }
+        return true;
+    }
+    
+    // Serve city, route and ranking queries from a mapped snapshot file
+    bool attachSnapshot(const string& path) {
+        auto start = chrono::steady_clock::now();
+        if (!snapshot.open(path)) {
+            cout << "Could not open snapshot " << path << "\n";
+            return false;
+        }
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        StreamFormatGuard format;
+        cout << "Mapped snapshot " << path << " (" << snapshot.cityCount() << " cities) in "
+             << fixed << setprecision(2) << elapsed.count() << " ms\n";
+        return true;
+    }
+    
+    // Read-only listings over the planner's cities, without copies
+    template <typename Visitor>
+    void forEachCity(Visitor visit) const {
+        catalog->cityDatabase.forEachCity(visit);
+    }
+    
+    template <typename Visitor>
+    void forEachCityInRange(const string& from, const string& to, Visitor visit) const {
+        catalog->cityDatabase.forEachInRange(from, to, visit);
+    }
+    
+    template <typename Visitor>
+    void forEachTopDestination(size_t n, Visitor visit) const {
+        catalog->popularDestinations.forEachTopDestination(n, visit);
+    }
+    
+    // Plan a new trip between two cities
+    void planTrip() {
+        string source, destination, date;
+        
+        cout << "\n=== Plan New Trip ===\n";
+        cout << "Enter source city: ";
+        cin.ignore();
+        getline(cin, source);
+        cout << "Enter destination city: ";
+        getline(cin, destination);
+        cout << "Enter travel date (YYYY-MM-DD): ";
+        getline(cin, date);
+        int32_t day;
+        if (!Trip::parseDate(date, day)) {
+            cout << "Invalid date '" << date << "', expected YYYY-MM-DD.\n";
+            return;
+        }
+        cout << "Search mode (1=Dijkstra, 2=Bidirectional, 3=A*, 4=Contraction Hierarchy,\n"
+             << "             5=Compare price / distance / legs, 6=Alternative routes,\n"
+             << "             7=A* with landmarks) [1]: ";
+        string modeChoice;
+        getline(cin, modeChoice);
+        
+        if (modeChoice == "7" && !snapshot.isOpen() && !catalog->routeGraph.hasLandmarks()) {
+            catalog->routeGraph.buildLandmarks(); // once, on first use
+            publishRoutes();
+        }
+        shared_ptr<const PlannerSnapshot> published = queryEngine.snapshot();
+        const RouteGraph& graph = published->routeGraph();
+        
+        RoutePlan route;
+        if ((modeChoice == "5" || modeChoice == "6") && !snapshot.isOpen()) {
+            vector<RoutePlan> options;
+            if (modeChoice == "5") {
+                options = graph.paretoRoutes(source, destination);
+            } else {
+                for (const auto& found : graph.kShortestPaths(source, destination, ALTERNATIVE_ROUTES)) {
+                    RoutePlan plan;
+                    graph.describePath(found.second, plan);
+                    options.push_back(plan);
+                }
+            }
+            if (options.empty()) {
+                cout << "No route found between " << source << " and " << destination << "\n";
+                return;
+            }
+            cout << (modeChoice == "5" ? "\n--- Routes (none beaten on price, distance and legs at once) ---\n"
+                                       : "\n--- Shortest alternative routes ---\n");
+            for (size_t i = 0; i < options.size(); i++) {
+                cout << i + 1 << ". ";
+                options[i].display();
+            }
+            cout << "Choose a route [1]: ";
+            string pick;
+            getline(cin, pick);
+            size_t index = 1;
+            from_chars(pick.data(), pick.data() + pick.size(), index);
+            route = options[index >= 1 && index <= options.size() ? index - 1 : 0];
+        } else {
+            SearchMode mode = SearchMode::Dijkstra;
+            if (modeChoice == "2") mode = SearchMode::Bidirectional;
+            else if (modeChoice == "3") mode = SearchMode::AStar;
+            else if (modeChoice == "4") mode = SearchMode::Hierarchy;
+            else if (modeChoice == "7") mode = SearchMode::Landmarks;
+            if (mode == SearchMode::Hierarchy && !snapshot.isOpen() && !graph.hasContractionHierarchy()) {
+                cout << "No current contraction hierarchy (see --ch); using bidirectional search.\n";
+            }
+            
+            // Find shortest path using the selected search; a mapped snapshot
+            // runs plain Dijkstra over its stored routes
+            auto result = snapshot.isOpen() ? snapshot.findShortestPath(source, destination)
+                                            : graph.findShortestPath(source, destination, mode);
+            
+            if (result.first == -1) {
+                cout << "No route found between " << source << " and " << destination << "\n";
+                return;
+            }
+            bool described = snapshot.isOpen() ? snapshot.describePath(result.second, route)
+                                               : graph.describePath(result.second, route);
+            if (!described) {
+                route.path = result.second;
+                route.distance = result.first;
+                route.price = result.first * 0.1; // $0.10 per km
+                route.legs = result.second.size() - 1;
+                route.modes.assign(route.legs, TravelMode::Road);
+            }
+        }
+        
+        int distance = route.distance;
+        int estimatedCost = route.price;
+        
+        cout << "\n--- Route Found ---\n";
+        cout << "Path: ";
+        for (size_t i = 0; i < route.path.size(); i++) {
+            if (i > 0) cout << " -(" << RouteAttributes::modeName(route.modes[i - 1]) << ")-> ";
+            cout << route.path[i];
+        }
+        cout << "\nTotal Distance: " << distance << " km\n";
+        cout << "Travel Time: " << route.duration / 60 << "h" << setw(2) << setfill('0') << route.duration % 60
+             << setfill(' ') << "\n";
+        cout << "Estimated Cost: $" << estimatedCost << "\n";
+        
+        // Create and add trip to future trips queue
+        Trip newTrip(tripCities.intern(source), tripCities.intern(destination), distance, estimatedCost, day);
+        execute(PlannerCommand::Kind::Plan, newTrip, TripScheduler::INVALID_ID);
+        
+        cout << "Trip added to your future trips!\n";
+    }
+    
+    // Undo the most recent planner operation
+    bool undo() {
+        if (undoLog.empty()) return false;
+        PlannerCommand command = undoLog.back();
+        undoLog.pop_back();
+        runCommand(command, false);
+        cout << "Undid " << describe(command, tripCities) << "\n";
+        redoLog.push_back(command);
+        return true;
+    }
+    
+    // Re-apply the most recently undone operation
+    bool redo() {
+        if (redoLog.empty()) return false;
+        PlannerCommand command = redoLog.back();
+        redoLog.pop_back();
+        runCommand(command, true);
+        cout << "Redid " << describe(command, tripCities) << "\n";
+        undoLog.push_back(command);
+        return true;
+    }
+    
+    // Page through the travel history and undo/redo planner operations.
+    // The listing walks an O(1) snapshot of the history, so nothing is
+    // copied however long it is.
+    void viewTravelHistory() {
+        cout << "\n=== Travel History ===\n";
+        
+        PersistentStack<Trip> view = travelHistory;
+        auto it = view.begin();
+        size_t shown = 0;
+        
+        while (true) {
+            if (view.empty()) {
+                cout << "No travel history available.\n";
+            } else if (shown < view.size()) {
+                cout << "Recent trips (most recent first), " << shown + 1 << "-"
+                     << min(shown + HISTORY_PAGE, view.size()) << " of " << view.size() << ":\n";
+                for (size_t i = 0; i < HISTORY_PAGE && it != view.end(); i++, ++it, shown++) {
+                    it->displayTrip(tripCities);
+                }
+            }
+            
+            cout << "\n";
+            if (shown < view.size()) cout << "n = next page, ";
+            if (!undoLog.empty()) cout << "u = undo " << describe(undoLog.back(), tripCities) << ", ";
+            if (!redoLog.empty()) cout << "r = redo " << describe(redoLog.back(), tripCities) << ", ";
+            cout << "q = back: ";
+            
+            char choice;
+            if (!(cin >> choice)) return;
+            if (choice == 'n' || choice == 'N') {
+                if (shown >= view.size()) cout << "No more trips.\n";
+                continue;
+            }
+            if (choice == 'u' || choice == 'U' || choice == 'r' || choice == 'R') {
+                bool done = (choice == 'u' || choice == 'U') ? undo() : redo();
+                if (!done) cout << "Nothing to " << (choice == 'u' || choice == 'U' ? "undo" : "redo") << ".\n";
+                
+                // Start over on the updated history
+                view = travelHistory;
+                it = view.begin();
+                shown = 0;
+                continue;
+            }
+            return;
+        }
+    }
+    
+    // Prompt for a YYYY-MM-DD date; false if the input is not one
+    bool readDate(const string& prompt, int32_t& day) {
+        cout << prompt;
+        string date;
+        cin >> date;
+        if (Trip::parseDate(date, day)) return true;
+        cout << "Invalid date '" << date << "', expected YYYY-MM-DD.\n";
+        return false;
+    }
+    
+    // Complete a scheduled trip and move it to the travel history
+    void completeTrip(uint32_t id) {
+        Trip trip = futureTrips.trip(id);
+        trip.status = TripStatus::Completed;
+        execute(PlannerCommand::Kind::Complete, trip, id);
+        cout << "Completed trip: ";
+        trip.displayTrip(tripCities);
+    }
+    
+    // Manage future trips using the date-ordered scheduler
+    void manageFutureTrips() {
+        cout << "\n=== Future Trips Management ===\n";
+        cout << "1. View upcoming trips\n";
+        cout << "2. Cancel a trip\n";
+        cout << "3. Mark next trip as completed\n";
+        cout << "4. Complete all trips due by a date\n";
+        cout << "5. Reschedule a trip\n";
+        cout << "6. Show trips in a date range\n";
+        cout << "Enter choice: ";
+        
+        int choice;
+        cin >> choice;
+        
+        if (choice >= 1 && choice <= 6 && futureTrips.empty()) {
+            cout << "No upcoming trips planned.\n";
+            return;
+        }
+        
+        auto show = [this](uint32_t id, const Trip& trip) {
+            cout << "[" << id << "] ";
+            trip.displayTrip(tripCities);
+        };
+        
+        switch (choice) {
+            case 1: {
+                cout << "\nUpcoming trips (by date):\n";
+                futureTrips.forEachTrip(show);
+                break;
+            }
+            
+            case 2: {
+                cout << "Trip ID to cancel: ";
+                uint32_t id;
+                cin >> id;
+                
+                if (!futureTrips.contains(id)) {
+                    cout << "No scheduled trip with ID " << id << ".\n";
+                    return;
+                }
+                Trip cancelledTrip = futureTrips.trip(id);
+                execute(PlannerCommand::Kind::Cancel, cancelledTrip, id);
+                cout << "Cancelled trip: ";
+                cancelledTrip.displayTrip(tripCities);
+                break;
+            }
+            
+            case 3: {
+                completeTrip(futureTrips.next());
+                break;
+            }
+            
+            case 4: {
+                int32_t day;
+                if (!readDate("Complete trips dated on or before (YYYY-MM-DD): ", day)) return;
+                
+                // One undoable completion per trip, earliest first
+                size_t completed = 0;
+                while (!futureTrips.empty() && futureTrips.trip(futureTrips.next()).day <= day) {
+                    completeTrip(futureTrips.next());
+                    completed++;
+                }
+                cout << completed << " trips completed.\n";
+                break;
+            }
+            
+            case 5: {
+                cout << "Trip ID to reschedule: ";
+                uint32_t id;
+                cin >> id;
+                if (!futureTrips.contains(id)) {
+                    cout << "No scheduled trip with ID " << id << ".\n";
+                    return;
+                }
+                int32_t day;
+                if (!readDate("New date (YYYY-MM-DD): ", day)) return;
+                
+                execute(PlannerCommand::Kind::Reschedule, futureTrips.trip(id), id, day);
+                cout << "Rescheduled: ";
+                futureTrips.trip(id).displayTrip(tripCities);
+                break;
+            }
+            
+            case 6: {
+                int32_t fromDay, toDay;
+                if (!readDate("From (YYYY-MM-DD): ", fromDay) || !readDate("To (YYYY-MM-DD): ", toDay)) return;
+                cout << "\nTrips between " << Trip::formatDate(fromDay) << " and " << Trip::formatDate(toDay) << ":\n";
+                futureTrips.forEachInRange(fromDay, toDay, show);
+                break;
+            }
+            
+            default:
+                cout << "Invalid choice.\n";
+        }
+    }
+    
+    // Search city information using the B-tree index
+    void searchCityInfo() {
+        cout << "\n=== City Information Search ===\n";
+        cout << "Enter city name: ";
+        
+        string cityName;
+        cin.ignore();
+        getline(cin, cityName);
+        
+        if (snapshot.isOpen()) {
+            uint32_t id = snapshot.findCity(cityName);
+            if (id != CityInterner::INVALID_ID && snapshot.hasCityData(id)) {
+                snapshot.displayCity(id);
+            } else {
+                cout << "City '" << cityName << "' not found in snapshot.\n";
+            }
+            return;
+        }
+        
+        City* city = catalog->cityDatabase.findCity(cityName);
+        
+        if (city) {
+            city->displayInfo();
+        } else {
+            cout << "City '" << cityName << "' not found in database.\n";
+            
+            // Show available cities
+            cout << "\nAvailable cities:\n";
+            forEachCity([](const City& c) {
+                cout << "- " << c.name << ", " << c.country << "\n";
+            });
+        }
+    }
+    
+    // Get top destination recommendations using heap
+    void getTopDestinations() {
+        cout << "\n=== Top Destination Recommendations ===\n";
+        cout << "How many top destinations would you like to see? ";
+        
+        int n;
+        cin >> n;
+        
+        cout << "\nTop " << n << " destinations by popularity:\n";
+        int rank = 0;
+        if (snapshot.isOpen()) {
+            for (uint32_t id : snapshot.ranking()) {
+                if (rank >= n) break;
+                cout << ++rank << ". " << snapshot.cityName(id)
+                     << " (Popularity: " << snapshot.city(id).popularity << ")\n";
+            }
+            return;
+        }
+        forEachTopDestination(max(n, 0), [&rank](const string& name, double popularity) {
+            cout << ++rank << ". " << name
+                 << " (Popularity: " << popularity << ")\n";
+        });
+    }
+    
+    // Destinations within a distance budget of one or more start cities,
+    // nearest first, from a single bounded search
+    void nearbyDestinations() {
+        cout << "\n=== Nearby Destinations ===\n";
+        cout << "Start cities (comma-separated): ";
+        string line;
+        cin.ignore();
+        getline(cin, line);
+        cout << "Maximum distance (km): ";
+        string budget;
+        getline(cin, budget);
+        cout << "How many results? [10]: ";
+        string countText;
+        getline(cin, countText);
+        
+        vector<string> sources = splitCityList(line);
+        int maxDistance = 0;
+        size_t limit = 10;
+        auto parsed = from_chars(budget.data(), budget.data() + budget.size(), maxDistance);
+        bool valid = parsed.ec == errc() && parsed.ptr == budget.data() + budget.size();
+        if (!countText.empty()) {
+            parsed = from_chars(countText.data(), countText.data() + countText.size(), limit);
+            valid = valid && parsed.ec == errc() && parsed.ptr == countText.data() + countText.size();
+        }
+        if (!valid || sources.empty()) {
+            cout << "Enter at least one city and a whole number of km.\n";
+            return;
+        }
+        
+        cout << "\nWithin " << maxDistance << " km:\n";
+        size_t shown = 0;
+        auto show = [&](const string& name, int distance, const string& origin, double popularity) {
+            if (name == origin) return true; // a start city itself
+            if (shown >= limit) return false;
+            cout << ++shown << ". " << name << " - " << distance << " km from " << origin;
+            if (!std::isnan(popularity)) cout << " (Popularity: " << popularity << ")";
+            cout << "\n";
+            return true;
+        };
+        
+        if (snapshot.isOpen()) {
+            snapshot.forEachWithinAny(sources, maxDistance, [&](string_view name, int distance, string_view origin) {
+                uint32_t id = snapshot.findCity(name);
+                return show(string(name), distance, string(origin), snapshot.city(id).popularity);
+            });
+        } else {
+            shared_ptr<const PlannerSnapshot> published = queryEngine.snapshot();
+            published->routeGraph().forEachWithinAny(sources, maxDistance,
+                                                     [&](const string& name, int distance, const string& origin) {
+                const City* city = published->findCity(name);
+                return show(name, distance, origin, city ? city->popularity : NAN);
+            });
+        }
+        if (shown == 0) {
+            cout << "No destinations found.\n";
+        }
+    }
+    
+    // Order several stops into the shortest tour and plan each leg
+    void planTour() {
+        if (snapshot.isOpen()) {
+            // The optimizer needs the full route graph, which a mapped
+            // snapshot does not load
+            cout << "\nMulti-stop tours are not available with a mapped snapshot; start without --snapshot.\n";
+            return;
+        }
+        
+        cout << "\n=== Plan a Multi-Stop Tour ===\n";
+        cout << "Start city: ";
+        string start;
+        cin.ignore();
+        getline(cin, start);
+        cout << "Stops to visit, in any order (comma-separated): ";
+        string line;
+        getline(cin, line);
+        cout << "Return to " << start << " at the end? (y/n): ";
+        string roundTrip;
+        getline(cin, roundTrip);
+        cout << "Date of the first leg (YYYY-MM-DD): ";
+        string date;
+        getline(cin, date);
+        
+        int32_t day;
+        if (!Trip::parseDate(date, day)) {
+            cout << "Invalid date '" << date << "', expected YYYY-MM-DD.\n";
+            return;
+        }
+        vector<string> stops = splitCityList(line);
+        if (stops.empty()) {
+            cout << "Enter at least one stop.\n";
+            return;
+        }
+        
+        shared_ptr<const PlannerSnapshot> published = queryEngine.snapshot();
+        const RouteGraph& graph = published->routeGraph();
+        Itinerary tour = ItineraryPlanner::plan(graph, start, stops, roundTrip == "y" || roundTrip == "Y");
+        if (tour.totalDistance < 0) {
+            cout << "Some stops cannot be reached from " << start << ".\n";
+            return;
+        }
+        
+        vector<Trip> legs = tour.legs(graph, tripCities, day);
+        cout << "\n--- " << (tour.optimal ? "Shortest" : "Best found") << " tour: " << tour.totalDistance
+             << " km ---\n";
+        for (const Trip& leg : legs) {
+            leg.displayTrip(tripCities);
+        }
+        for (const Trip& leg : legs) {
+            execute(PlannerCommand::Kind::Plan, leg, TripScheduler::INVALID_ID);
+        }
+        cout << legs.size() << " legs added to your future trips (each can be undone).\n";
+    }
+    
+    // Change or close one route in place. Only cached routes the change
+    // can affect are dropped; a contraction hierarchy is fully
+    // re-contracted (in its previous order). Route edits are not undoable.
+    void updateRoutes() {
+        if (snapshot.isOpen()) {
+            cout << "\nRoutes served from a snapshot are read-only.\n";
+            return;
+        }
+        
+        cout << "\n=== Update / Close a Route ===\n";
+        cout << "From city: ";
+        string from;
+        cin.ignore();
+        getline(cin, from);
+        cout << "To city: ";
+        string to;
+        getline(cin, to);
+        cout << "Mode (Road/Rail/Air/Ferry) [Road]: ";
+        string modeText;
+        getline(cin, modeText);
+        TravelMode mode = TravelMode::Road;
+        if (!modeText.empty() && !RouteAttributes::parseMode(modeText, mode)) {
+            cout << "Unknown mode '" << modeText << "'.\n";
+            return;
+        }
+        
+        RouteGraph& graph = catalog->routeGraph;
+        RouteAttributes route = RouteAttributes::byRoad(0);
+        bool exists = graph.findRoute(from, to, mode, route);
+        if (exists) {
+            cout << "Current: " << route.distance << " km, $" << route.price << ", "
+                 << route.duration << " min\n";
+        }
+        cout << "New distance in km" << (exists ? ", or 'close' to remove the route" : "") << ": ";
+        string distanceText;
+        getline(cin, distanceText);
+        
+        auto start = chrono::steady_clock::now();
+        bool changed = false;
+        if (exists && distanceText == "close") {
+            changed = graph.removeRoute(from, to, mode);
+        } else {
+            int distance = 0;
+            auto parsed = from_chars(distanceText.data(), distanceText.data() + distanceText.size(), distance);
+            if (parsed.ec != errc() || parsed.ptr != distanceText.data() + distanceText.size() || distance <= 0) {
+                cout << "Enter a positive whole number of km.\n";
+                return;
+            }
+            if (!exists) {
+                route = RouteAttributes::byRoad(distance);
+            } else if (route.distance > 0) {
+                // Keep the route's price and speed per km
+                route.price = static_cast<int>(static_cast<long long>(route.price) * distance / route.distance);
+                route.duration = static_cast<int>(static_cast<long long>(route.duration) * distance / route.distance);
+            }
+            route.distance = distance;
+            route.mode = mode;
+            graph.updateRoute(from, to, route);
+            changed = true;
+        }
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        if (!changed) {
+            cout << "No such route.\n";
+            return;
+        }
+        
+        // Re-contract before publishing, so queries never see the change
+        // without a current hierarchy
+        chrono::duration<double, milli> refreshElapsed(0);
+        bool refreshed = graph.hierarchyNeedsRefresh();
+        if (refreshed) {
+            start = chrono::steady_clock::now();
+            graph.refreshContractionHierarchy();
+            refreshElapsed = chrono::steady_clock::now() - start;
+        }
+        start = chrono::steady_clock::now();
+        publishRoutes();
+        chrono::duration<double, milli> publishElapsed = chrono::steady_clock::now() - start;
+        
+        StreamFormatGuard format;
+        cout << (distanceText == "close" ? "Closed " : exists ? "Updated " : "Added ") << RouteAttributes::modeName(mode)
+             << " route " << from << " - " << to << " in " << fixed << setprecision(3)
+             << (elapsed + publishElapsed).count() << " ms (" << publishElapsed.count() << " ms publishing)";
+        if (refreshed) {
+            cout << "; contraction hierarchy fully re-contracted in " << refreshElapsed.count() << " ms";
+        }
+        format.restore();
+        cout << "\n";
+    }
+    
+    // Sort and display trips
+    void sortTrips() {
+        if (allTrips.empty()) {
+            cout << "\nNo trips available to sort.\n";
+            return;
+        }
+        
+        cout << "\n=== Sort Trips ===\n";
+        cout << "1. Sort by Cost, then Distance, then Date\n";
+        cout << "2. Sort by Distance, then Cost, then Date\n";
+        cout << "3. Sort by Date, then Cost\n";
+        cout << "Enter choice: ";
+        
+        int choice;
+        cin >> choice;
+        
+        vector<TripKey> keys;
+        switch (choice) {
+            case 1: keys = {TripKey::Cost, TripKey::Distance, TripKey::Date}; break;
+            case 2: keys = {TripKey::Distance, TripKey::Cost, TripKey::Date}; break;
+            case 3: keys = {TripKey::Date, TripKey::Cost}; break;
+            default:
+                cout << "Invalid choice.\n";
+                return;
+        }
+        
+        cout << "\nSorted trips (ascending):\n";
+        for (uint32_t index : TripSorter::sortedOrder(allTrips, keys)) {
+            allTrips[index].displayTrip(tripCities);
+        }
+    }
+    
+    // Columnar table of every trip with its current status: history is
+    // completed, the queue is planned, and planned trips in allTrips that
+    // are in neither were cancelled
+    void refreshReports() {
+        if (!reportsStale) return;
+        map<pair<uint64_t, uint64_t>, size_t> open;
+        auto keyOf = [](const Trip& t) {
+            return make_pair(static_cast<uint64_t>(t.source) << 32 | t.destination,
+                             static_cast<uint64_t>(static_cast<uint32_t>(t.day)) << 32 | static_cast<uint32_t>(t.cost));
+        };
+        for (const auto& trip : allTrips) open[keyOf(trip)]++;
+        
+        tripTable.clear();
+        tripTable.reserve(allTrips.size() + travelHistory.size());
+        auto add = [&](const Trip& trip) {
+            tripTable.append(trip);
+            auto it = open.find(keyOf(trip));
+            if (it != open.end() && it->second > 0) it->second--;
+        };
+        for (const auto& trip : travelHistory) add(trip);
+        futureTrips.forEachTrip([&](uint32_t, const Trip& trip) { add(trip); });
+        for (const auto& trip : allTrips) {
+            auto it = open.find(keyOf(trip));
+            if (it->second == 0) continue;
+            it->second--;
+            Trip cancelled = trip;
+            cancelled.status = TripStatus::Cancelled;
+            tripTable.append(cancelled);
+        }
+        reportsStale = false;
+    }
+    
+    // Spend, distance and route reports over the columnar trip table
+    void tripReports() {
+        refreshReports();
+        StreamFormatGuard format;
+        cout << "\n=== Trip Reports ===\n";
+        if (tripTable.size() == 0) {
+            cout << "No trips recorded yet.\n";
+            return;
+        }
+        
+        array<size_t, 3> counts = tripTable.statusCounts();
+        size_t completed = counts[static_cast<size_t>(TripStatus::Completed)];
+        size_t cancelled = counts[static_cast<size_t>(TripStatus::Cancelled)];
+        cout << "Trips: " << tripTable.size() << " (" << completed << " completed, "
+             << counts[static_cast<size_t>(TripStatus::Planned)] << " planned, " << cancelled << " cancelled)\n";
+        if (completed + cancelled > 0) {
+            cout << "Completion rate: " << fixed << setprecision(1)
+                 << 100.0 * completed / (completed + cancelled) << "% of closed trips\n";
+            format.restore();
+        }
+        
+        TripColumns::Filter active;
+        active.statuses = TripColumns::Filter::only(TripStatus::Completed) | TripColumns::Filter::only(TripStatus::Planned);
+        vector<TripColumns::Aggregate> totals =
+            tripTable.aggregate({TripColumns::Column::Cost, TripColumns::Column::Distance}, active);
+        if (totals[0].count > 0) {
+            cout << "Spend (completed + planned): $" << totals[0].sum << " total, $" << fixed << setprecision(0)
+                 << totals[0].mean() << " average, $" << totals[0].min << "-$" << totals[0].max << "\n";
+            cout << "Distance: " << totals[1].sum << " km total, " << totals[1].mean() << " km average\n";
+            format.restore();
+        }
+        
+        cout << "\nSpend per month:\n";
+        for (const auto& month : tripTable.groupByMonth(TripColumns::Column::Cost, active)) {
+            int32_t number = static_cast<int32_t>(month.key);
+            cout << "  " << setfill('0') << setw(4) << number / 12 << "-" << setw(2) << number % 12 + 1
+                 << setfill(' ') << "  $" << month.value.sum << " (" << month.value.count << " trips)\n";
+        }
+        
+        const int32_t bucketKm = 2500;
+        vector<size_t> histogram = tripTable.histogram(TripColumns::Column::Distance, bucketKm, 6, active);
+        cout << "\nDistance distribution:\n";
+        for (size_t b = 0; b < histogram.size(); b++) {
+            cout << "  " << setw(6) << b * bucketKm << (b + 1 < histogram.size() ? "-" + to_string((b + 1) * bucketKm - 1) : "+")
+                 << " km: " << histogram[b] << "\n";
+        }
+        
+        vector<TripColumns::Group> routes = tripTable.groupByRoute(TripColumns::Column::Cost);
+        cout << "\nMost frequent routes:\n";
+        for (size_t i = 0; i < routes.size() && i < 5; i++) {
+            cout << "  " << tripCities.name(routes[i].key >> 32) << " -> " << tripCities.name(routes[i].key & 0xFFFFFFFF)
+                 << ": " << routes[i].value.count << " trips, $" << routes[i].value.sum << "\n";
+        }
+    }
+    
+    // Display all available routes
+    void displayRoutes() {
+        shared_ptr<const PlannerSnapshot> published = queryEngine.snapshot();
+        published->routeGraph().displayRoutes();
+        
+        RouteCacheStats cacheStats = published->routeGraph().routeCacheStats();
+        StreamFormatGuard format;
+        cout << "\nRoute cache: " << cacheStats.entries << " entries, " << cacheStats.hits << " hits, "
+             << cacheStats.misses << " misses, " << cacheStats.evictions << " evictions, "
+             << cacheStats.invalidations << " invalidated (" << fixed << setprecision(1)
+             << cacheStats.hitRate() * 100 << "% hit rate)\n";
+    }
+    
+    // Save trip data or a binary catalog snapshot, or import a catalog
+    void saveDataToFile() {
+        cout << "\n1. Trip data (" << tripStore.path() << ")\n";
+        cout << "2. Catalog snapshot\n";
+        cout << "3. Import catalog from a directory (undoable)\n";
+        cout << "Enter choice: ";
+        
+        int choice;
+        cin >> choice;
+        if (choice == 3) {
+            cout << "Catalog directory: ";
+            string directory;
+            cin.ignore();
+            getline(cin, directory);
+            importCatalog(directory);
+            return;
+        }
+        if (choice == 2) {
+            cout << "Snapshot file [catalog.snap]: ";
+            string path;
+            cin.ignore();
+            getline(cin, path);
+            saveSnapshotToFile(path.empty() ? "catalog.snap" : path);
+            return;
+        }
+        
+        if (saveTrips()) {
+            cout << "Data saved to " << tripStore.path() << " successfully!\n";
+        }
+    }
+    
+    // Write cities, routes and rankings for fast startup via --snapshot
+    bool saveSnapshotToFile(const string& path) {
+        if (snapshot.isOpen()) {
+            cout << "Catalog is already served from a snapshot.\n";
+            return false;
+        }
+        SnapshotWriter writer;
+        if (!writer.write(path, catalog->cityDatabase, catalog->popularDestinations, catalog->routeGraph)) {
+            cout << "Error: Could not write snapshot " << path << "\n";
+            return false;
+        }
+        cout << "Snapshot saved to " << path << " successfully!\n";
+        return true;
+    }
+    
+    // Display main menu
+    void displayMenu() {
+        cout << "\n" << string(50, '=') << "\n";
+        cout << "        SMART TRAVEL PLANNER\n";
+        cout << string(50, '=') << "\n";
+        cout << "1. Plan a Trip (Graph + Dijkstra's)\n";
+        cout << "2. Travel History & Undo/Redo\n";
+        cout << "3. Manage Future Trips (Date Scheduler)\n";
+        cout << "4. Search City Information (B-Tree Index)\n";
+        cout << "5. Get Top Destinations (Heap)\n";
+        cout << "6. Sort Trips (Multi-Key Radix Sort)\n";
+        cout << "7. Display Available Routes\n";
+        cout << "8. Save / Import Data\n";
+        cout << "9. Trip Reports (Columnar Analytics)\n";
+        cout << "10. Nearby Destinations (Bounded Search)\n";
+        cout << "11. Plan a Multi-Stop Tour (Itinerary Optimizer)\n";
+        cout << "12. Update / Close a Route (Dynamic Updates)\n";
+        cout << "0. Exit\n";
+        cout << string(50, '=') << "\n";
+        cout << "Enter your choice: ";
+    }
+    
+    // Main program loop
+    void run() {
+        int choice;
+        
+        do {
+            displayMenu();
+            if (!(cin >> choice)) {
+                // End of input exits; anything else unreadable is skipped
+                if (cin.eof()) {
+                    choice = 0;
+                } else {
+                    cin.clear();
+                    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                    choice = -1;
+                }
+            }
+            
+            switch (choice) {
+                case 1: planTrip(); break;
+                case 2: viewTravelHistory(); break;
+                case 3: manageFutureTrips(); break;
+                case 4: searchCityInfo(); break;
+                case 5: getTopDestinations(); break;
+                case 6: sortTrips(); break;
+                case 7: displayRoutes(); break;
+                case 8: saveDataToFile(); break;
+                case 9: tripReports(); break;
+                case 10: nearbyDestinations(); break;
+                case 11: planTour(); break;
+                case 12: updateRoutes(); break;
+                case 0: cout << "Thank you for using Smart Travel Planner!\n"; break;
+                default: cout << "Invalid choice. Please try again.\n";
+            }
+            
+            if (choice != 0) {
+                cout << "\nPress Enter to continue...";
+                cin.ignore();
+                cin.get();
+            }
+            
+        } while (choice != 0);
+        
+        if (tripStore.pendingRecords() > 0) {
+            saveTrips();
+        }
+    }
+};
+
+// Synthetic workloads for measuring the planner's data structures
+class PlannerBenchmarks {
+private:
+    typedef chrono::steady_clock Clock;
+    
+    static double elapsedMs(Clock::time_point start) {
+        return chrono::duration<double, milli>(Clock::now() - start).count();
+    }
+    
+    // Jittered grid of cities over Europe; each city links to its right and
+    // lower neighbours plus an occasional diagonal, with road distances at
+    // or above the great-circle distance
+    static void buildGeoGraph(RouteGraph& graph, int side, mt19937& rng) {
+        uniform_real_distribution<double> jitter(-0.02, 0.02);
+        uniform_real_distribution<double> detour(1.0, 1.3);
+        vector<double> lat(side * side), lon(side * side);
+        
+        for (int r = 0; r < side; r++) {
+            for (int c = 0; c < side; c++) {
+                int id = r * side + c;
+                lat[id] = 36.0 + 20.0 * r / side + jitter(rng);
+                lon[id] = -8.0 + 30.0 * c / side + jitter(rng);
+                graph.setCityLocation("C" + to_string(id), lat[id], lon[id]);
+            }
+        }
+        
+        auto link = [&](int a, int b) {
+            double km = greatCircleKm(lat[a], lon[a], lat[b], lon[b]);
+            graph.addRoute("C" + to_string(a), "C" + to_string(b), static_cast<int>(ceil(km * detour(rng))));
+        };
+        for (int r = 0; r < side; r++) {
+            for (int c = 0; c < side; c++) {
+                int id = r * side + c;
+                if (c + 1 < side) link(id, id + 1);
+                if (r + 1 < side) link(id, id + side);
+                if (r + 1 < side && c + 1 < side && rng() % 4 == 0) link(id, id + side + 1);
+            }
+        }
+        graph.freeze();
+    }
+    
+    // Legacy last-element-pivot quicksort, kept as the benchmark baseline
+    static void legacyQuickSortByCost(vector<Trip>& trips, int low, int high) {
+        if (low >= high) return;
+        int pivot = trips[high].cost;
+        int i = low - 1;
+        for (int j = low; j < high; j++) {
+            if (trips[j].cost <= pivot) swap(trips[++i], trips[j]);
+        }
+        swap(trips[i + 1], trips[high]);
+        legacyQuickSortByCost(trips, low, i);
+        legacyQuickSortByCost(trips, i + 2, high);
+    }
+    
+    // Legacy merge sort that allocates both halves at every level
+    static void legacyMergeSortByDistance(vector<Trip>& trips, int left, int right) {
+        if (left >= right) return;
+        int mid = left + (right - left) / 2;
+        legacyMergeSortByDistance(trips, left, mid);
+        legacyMergeSortByDistance(trips, mid + 1, right);
+        vector<Trip> leftArr(trips.begin() + left, trips.begin() + mid + 1);
+        vector<Trip> rightArr(trips.begin() + mid + 1, trips.begin() + right + 1);
+        size_t i = 0, j = 0;
+        int k = left;
+        while (i < leftArr.size() && j < rightArr.size()) {
+            trips[k++] = leftArr[i].distance <= rightArr[j].distance ? leftArr[i++] : rightArr[j++];
+        }
+        while (i < leftArr.size()) trips[k++] = leftArr[i++];
+        while (j < rightArr.size()) trips[k++] = rightArr[j++];
+    }
+    
+    // Textbook Yen: a full Dijkstra with fresh arrays for every spur node,
+    // no bounds and no candidate limit; returns the k path lengths
+    static vector<int> naiveYen(const RouteGraph& graph, uint32_t src, uint32_t dst, size_t k) {
+        const CSRGraph& csr = graph.adjacency();
+        uint32_t n = csr.nodeCount();
+        auto search = [&](uint32_t from, const vector<bool>& removedNode, const set<pair<uint32_t, uint32_t>>& removedEdge,
+                          vector<uint32_t>& path) {
+            vector<int> dist(n, INT_MAX);
+            vector<uint32_t> parent(n, UINT32_MAX);
+            priority_queue<pair<int, uint32_t>, vector<pair<int, uint32_t>>, greater<pair<int, uint32_t>>> pq;
+            dist[from] = 0;
+            pq.push({0, from});
+            while (!pq.empty()) {
+                auto [d, u] = pq.top();
+                pq.pop();
+                if (d > dist[u]) continue;
+                for (uint32_t e = csr.offsets[u]; e < csr.offsets[u + 1]; e++) {
+                    uint32_t v = csr.targets[e];
+                    if (removedNode[v] || removedEdge.count({u, v})) continue;
+                    if (d + csr.weights[e] < dist[v]) {
+                        dist[v] = d + csr.weights[e];
+                        parent[v] = u;
+                        pq.push({dist[v], v});
+                    }
+                }
+            }
+            path.clear();
+            if (dist[dst] == INT_MAX) return -1;
+            for (uint32_t v = dst; v != UINT32_MAX; v = parent[v]) path.push_back(v);
+            reverse(path.begin(), path.end());
+            return dist[dst];
+        };
+        auto legCost = [&](uint32_t u, uint32_t v) {
+            int best = INT_MAX;
+            for (uint32_t e = csr.offsets[u]; e < csr.offsets[u + 1]; e++) {
+                if (csr.targets[e] == v) best = min(best, csr.weights[e]);
+            }
+            return best;
+        };
+        
+        vector<pair<int, vector<uint32_t>>> found(1);
+        found[0].first = search(src, vector<bool>(n, false), {}, found[0].second);
+        if (found[0].first < 0) return {};
+        set<pair<int, vector<uint32_t>>> candidates;
+        while (found.size() < k) {
+            const vector<uint32_t> last = found.back().second;
+            for (size_t i = 0; i + 1 < last.size(); i++) {
+                vector<bool> removedNode(n, false);
+                set<pair<uint32_t, uint32_t>> removedEdge;
+                for (size_t j = 0; j < i; j++) removedNode[last[j]] = true;
+                for (const auto& p : found) {
+                    if (p.second.size() > i + 1 && equal(p.second.begin(), p.second.begin() + i + 1, last.begin())) {
+                        removedEdge.insert({last[i], p.second[i + 1]});
+                    }
+                }
+                vector<uint32_t> spur;
+                int spurDist = search(last[i], removedNode, removedEdge, spur);
+                if (spurDist < 0) continue;
+                int rootDist = 0;
+                for (size_t j = 0; j < i; j++) rootDist += legCost(last[j], last[j + 1]);
+                vector<uint32_t> path(last.begin(), last.begin() + i);
+                path.insert(path.end(), spur.begin(), spur.end());
+                bool known = false;
+                for (const auto& p : found) known = known || p.second == path;
+                if (!known) candidates.insert({rootDist + spurDist, path});
+            }
+            if (candidates.empty()) break;
+            found.push_back(*candidates.begin());
+            candidates.erase(candidates.begin());
+        }
+        vector<int> lengths;
+        for (const auto& p : found) lengths.push_back(p.first);
+        return lengths;
+    }
+    
+public:
+    // Settled-node counts and latency of each findShortestPath mode
+    static void searchModes() {
+        const int side = 300;
+        const int queries = 200;
+        mt19937 rng(42);
+        RouteGraph graph;
+        buildGeoGraph(graph, side, rng);
+        
+        vector<pair<string, string>> pairs;
+        uniform_int_distribution<int> pick(0, side * side - 1);
+        for (int i = 0; i < queries; i++) {
+            pairs.push_back({"C" + to_string(pick(rng)), "C" + to_string(pick(rng))});
+        }
+        
+        cout << "\n=== Search mode benchmark (" << side * side << " cities, " << queries << " queries) ===\n";
+        const pair<SearchMode, const char*> modes[] = {
+            {SearchMode::Dijkstra, "Dijkstra"},
+            {SearchMode::Bidirectional, "Bidirectional"},
+            {SearchMode::AStar, "A*"}
+        };
+        
+        vector<int> reference;
+        for (const auto& mode : modes) {
+            unsigned long long settled = 0;
+            int mismatches = 0;
+            auto start = Clock::now();
+            for (size_t i = 0; i < pairs.size(); i++) {
+                SearchStats stats;
+                int distance = graph.findShortestPath(pairs[i].first, pairs[i].second, mode.first, &stats).first;
+                settled += stats.settledNodes;
+                if (reference.size() < pairs.size()) reference.push_back(distance);
+                else if (reference[i] != distance) mismatches++;
+            }
+            double ms = elapsedMs(start);
+            cout << left << setw(15) << mode.second << right
+                 << " avg settled: " << setw(8) << settled / queries
+                 << "  avg time: " << fixed << setprecision(3) << ms / queries << " ms"
+                 << "  mismatches: " << mismatches << "\n";
+            cout.unsetf(ios::fixed);
+        }
+    }
+    
+    // Landmark preprocessing and ALT queries against Dijkstra and
+    // great-circle A*, with and without coordinates
+    static void landmarkSearch() {
+        const int side = 120;
+        const int queries = 500;
+        const int updates = 20;
+        mt19937 rng(25);
+        RouteGraph graph;
+        buildGeoGraph(graph, side, rng);
+        
+        cout << "\n=== Landmark (ALT) benchmark (" << side * side << " cities, " << queries << " queries) ===\n"
+             << fixed << setprecision(1);
+        auto start = Clock::now();
+        boundedSearch(graph.adjacency(), vector<uint32_t>{0}, INT_MAX, QueryWorkspace::local(),
+                      [](uint32_t, int, uint32_t) { return true; });
+        double searchMs = elapsedMs(start);
+        start = Clock::now();
+        graph.buildLandmarks();
+        double buildMs = elapsedMs(start);
+        const LandmarkTable& table = *graph.landmarkTable();
+        
+        const string path = "alt_benchmark.bin";
+        start = Clock::now();
+        graph.saveLandmarks(path);
+        double saveMs = elapsedMs(start);
+        start = Clock::now();
+        bool loaded = graph.loadLandmarks(path);
+        double loadMs = elapsedMs(start);
+        remove(path.c_str());
+        cout << "Preprocessing: " << table.count() << " landmarks in " << buildMs << " ms on "
+             << ThreadPool::shared().size() << " threads (one full search: " << searchMs << " ms), "
+             << table.bytes() / 1024 << " KB\n"
+             << "Save: " << saveMs << " ms, load: " << loadMs << " ms" << (loaded ? "" : " (FAILED)") << "\n";
+        
+        vector<pair<string, string>> pairs;
+        uniform_int_distribution<int> pick(0, side * side - 1);
+        for (int i = 0; i < queries; i++) {
+            pairs.push_back({"C" + to_string(pick(rng)), "C" + to_string(pick(rng))});
+        }
+        vector<int> reference;
+        auto measure = [&](SearchMode mode, const char* name) {
+            unsigned long long settled = 0;
+            int mismatches = 0;
+            start = Clock::now();
+            for (size_t i = 0; i < pairs.size(); i++) {
+                SearchStats stats;
+                int distance = graph.findShortestPath(pairs[i].first, pairs[i].second, mode, &stats).first;
+                settled += stats.settledNodes;
+                if (reference.size() < pairs.size()) reference.push_back(distance);
+                else if (reference[i] != distance) mismatches++;
+            }
+            double ms = elapsedMs(start);
+            cout << left << setw(24) << name << right << " avg settled: " << setw(8) << settled / queries
+                 << "  avg time: " << setprecision(3) << ms / queries << " ms  mismatches: " << mismatches
+                 << "\n" << setprecision(1);
+        };
+        measure(SearchMode::Dijkstra, "Dijkstra");
+        measure(SearchMode::AStar, "A* (coordinates)");
+        measure(SearchMode::Landmarks, "ALT");
+        double scale = graph.heuristicScale;
+        graph.heuristicScale = 0; // as if no city had coordinates
+        measure(SearchMode::AStar, "A* (no coordinates)");
+        graph.heuristicScale = scale;
+        
+        // Shorter routes repair the table instead of recomputing it
+        double repairMs = 0;
+        for (int i = 0; i < updates; i++) {
+            uint32_t r = pick(rng) % side, c = pick(rng) % (side - 1);
+            string a = "C" + to_string(r * side + c), b = "C" + to_string(r * side + c + 1);
+            RouteAttributes route;
+            if (!graph.findRoute(a, b, TravelMode::Road, route)) continue;
+            route.distance = max(1, route.distance / 4);
+            start = Clock::now();
+            graph.updateRoute(a, b, route);
+            repairMs += elapsedMs(start);
+        }
+        reference.clear();
+        measure(SearchMode::Dijkstra, "Dijkstra (updated)");
+        measure(SearchMode::Landmarks, "ALT (repaired)");
+        measure(SearchMode::AStar, "A* (updated)"); // routes now undercut great-circle km
+        cout << "Shorter route with table repair: " << setprecision(3) << repairMs / updates
+             << " ms per update against " << setprecision(1) << buildMs << " ms to recompute\n";
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Contraction time and query latency against plain Dijkstra
+    static void contractionHierarchy() {
+        const int side = 120;
+        const int queries = 500;
+        mt19937 rng(7);
+        RouteGraph graph;
+        buildGeoGraph(graph, side, rng);
+        
+        cout << "\n=== Contraction hierarchy benchmark (" << side * side << " cities) ===\n";
+        auto start = Clock::now();
+        graph.buildContractionHierarchy();
+        cout << "Preprocessing: " << fixed << setprecision(1) << elapsedMs(start) << " ms, "
+             << graph.hierarchyShortcuts() << " shortcuts\n";
+        
+        const string path = "ch_benchmark.bin";
+        start = Clock::now();
+        graph.saveContractionHierarchy(path);
+        double saveMs = elapsedMs(start);
+        start = Clock::now();
+        bool loaded = graph.loadContractionHierarchy(path);
+        cout << "Save: " << saveMs << " ms, load: " << elapsedMs(start) << " ms"
+             << (loaded ? "" : " (FAILED)") << "\n";
+        remove(path.c_str());
+        
+        vector<pair<string, string>> pairs;
+        uniform_int_distribution<int> pick(0, side * side - 1);
+        for (int i = 0; i < queries; i++) {
+            pairs.push_back({"C" + to_string(pick(rng)), "C" + to_string(pick(rng))});
+        }
+        
+        vector<pair<int, vector<string>>> reference;
+        for (SearchMode mode : {SearchMode::Dijkstra, SearchMode::Hierarchy}) {
+            unsigned long long settled = 0;
+            int mismatches = 0;
+            start = Clock::now();
+            for (size_t i = 0; i < pairs.size(); i++) {
+                SearchStats stats;
+                auto result = graph.findShortestPath(pairs[i].first, pairs[i].second, mode, &stats);
+                settled += stats.settledNodes;
+                if (reference.size() < pairs.size()) reference.push_back(result);
+                else if (reference[i].first != result.first ||
+                         reference[i].second.front() != result.second.front() ||
+                         reference[i].second.back() != result.second.back()) mismatches++;
+            }
+            double ms = elapsedMs(start);
+            cout << left << setw(15) << (mode == SearchMode::Dijkstra ? "Dijkstra" : "Hierarchy") << right
+                 << " avg settled: " << setw(8) << settled / queries
+                 << "  avg time: " << setprecision(3) << ms / queries << " ms"
+                 << "  mismatches: " << mismatches << "\n";
+        }
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Batched distance table against repeated point-to-point queries
+    static void distanceMatrix() {
+        const int side = 200;
+        const int count = 200;
+        const int sampledPairs = 400;
+        mt19937 rng(11);
+        RouteGraph graph;
+        buildGeoGraph(graph, side, rng);
+        
+        vector<string> sources, targets;
+        uniform_int_distribution<int> pick(0, side * side - 1);
+        for (int i = 0; i < count; i++) {
+            sources.push_back("C" + to_string(pick(rng)));
+            targets.push_back("C" + to_string(pick(rng)));
+        }
+        
+        cout << "\n=== Distance matrix benchmark (" << count << " x " << count << " on "
+             << side * side << " cities, " << ThreadPool::shared().size() << " threads) ===\n";
+        auto start = Clock::now();
+        vector<vector<int>> matrix = graph.distanceMatrix(sources, targets);
+        double batchedMs = elapsedMs(start);
+        
+        // Point-to-point cost is sampled and extrapolated to the full table
+        int mismatches = 0;
+        start = Clock::now();
+        for (int k = 0; k < sampledPairs; k++) {
+            int i = k % count, j = (k * 7) % count;
+            if (graph.findShortestPath(sources[i], targets[j]).first != matrix[i][j]) mismatches++;
+        }
+        double pairwiseMs = elapsedMs(start) / sampledPairs * count * count;
+        
+        cout << fixed << setprecision(1)
+             << "Batched distanceMatrix:      " << batchedMs << " ms\n"
+             << "findShortestPath per pair:   " << pairwiseMs << " ms (extrapolated)\n"
+             << "Speedup: " << pairwiseMs / batchedMs << "x, mismatches: " << mismatches << "\n";
+        cout.unsetf(ios::fixed);
+    }
+    
+    // "Everything within X km" as one bounded search against one
+    // findShortestPath per candidate city
+    static void boundedSearches() {
+        const int side = 200;
+        const int origins = 20;
+        const int budget = 300;
+        const int sampledCandidates = 200;
+        mt19937 rng(29);
+        RouteGraph graph;
+        buildGeoGraph(graph, side, rng);
+        
+        uniform_int_distribution<int> pick(0, side * side - 1);
+        vector<string> sources;
+        for (int i = 0; i < origins; i++) sources.push_back("C" + to_string(pick(rng)));
+        
+        cout << "\n=== Bounded search benchmark (" << side * side << " cities, " << budget << " km budget, "
+             << origins << " origins) ===\n";
+        vector<unordered_map<string, int>> within(origins);
+        auto start = Clock::now();
+        for (int i = 0; i < origins; i++) {
+            graph.forEachWithin(sources[i], budget, [&](const string& name, int distance) {
+                within[i][name] = distance;
+                return true;
+            });
+        }
+        double boundedMs = elapsedMs(start) / origins;
+        
+        start = Clock::now();
+        size_t nearest = 0;
+        for (int i = 0; i < origins; i++) nearest += graph.citiesWithin(sources[i], budget, 20).size();
+        double earlyMs = elapsedMs(start) / origins;
+        
+        start = Clock::now();
+        size_t covered = 0;
+        graph.forEachWithinAny(sources, budget, [&](const string&, int, const string&) { return ++covered > 0; });
+        double multiMs = elapsedMs(start);
+        
+        // Per-candidate queries are sampled and extrapolated to every city
+        int mismatches = 0;
+        start = Clock::now();
+        for (int k = 0; k < sampledCandidates; k++) {
+            int i = k % origins;
+            string candidate = "C" + to_string(pick(rng));
+            int distance = graph.findShortestPath(sources[i], candidate).first;
+            auto it = within[i].find(candidate);
+            bool inside = distance >= 0 && distance <= budget;
+            if (inside != (it != within[i].end()) || (inside && it->second != distance)) mismatches++;
+        }
+        double pairwiseMs = elapsedMs(start) / sampledCandidates * side * side;
+        
+        size_t found = 0;
+        for (const auto& m : within) found += m.size();
+        cout << fixed << setprecision(3)
+             << "Bounded search:            " << boundedMs << " ms per origin (" << found / origins << " cities)\n"
+             << "Nearest 20 (early stop):   " << earlyMs << " ms per origin (" << nearest / origins << " cities)\n"
+             << "Multi-source, all origins: " << multiMs << " ms (" << covered << " cities)\n"
+             << setprecision(1)
+             << "findShortestPath per city: " << pairwiseMs << " ms per origin (extrapolated)\n"
+             << "Speedup: " << pairwiseMs / boundedMs << "x, mismatches: " << mismatches << "\n";
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Pareto route sets over roads plus faster, pricier rail and air links,
+    // at several label-set bounds
+    static void paretoSearch() {
+        const int side = 100;
+        const int queries = 20;
+        mt19937 rng(31);
+        RouteGraph graph;
+        buildGeoGraph(graph, side, rng);
+        
+        uniform_int_distribution<int> pick(0, side * side - 1);
+        uniform_real_distribution<double> fare(0.8, 1.6);
+        for (int i = 0; i < side * side / 4; i++) {
+            int a = pick(rng), b = min(a + 1 + static_cast<int>(rng() % 5) * side, side * side - 1);
+            int km = 15 * (1 + abs(b - a) / side);
+            graph.addRoute("C" + to_string(a), "C" + to_string(b),
+                           {km, static_cast<int>(km * 0.2 * fare(rng)), km / 3 + 10, TravelMode::Rail});
+        }
+        for (int i = 0; i < 200; i++) {
+            int a = pick(rng), b = pick(rng);
+            int km = 5 * (abs(a / side - b / side) + abs(a % side - b % side)) + 50;
+            graph.addRoute("C" + to_string(a), "C" + to_string(b),
+                           {km, static_cast<int>(60 + km * 0.15 * fare(rng)), km / 12 + 90, TravelMode::Air});
+        }
+        
+        vector<pair<string, string>> pairs;
+        for (int i = 0; i < queries; i++) pairs.push_back({"C" + to_string(pick(rng)), "C" + to_string(pick(rng))});
+        
+        cout << "\n=== Pareto route benchmark (" << side * side << " cities, " << queries
+             << " queries, distance/price/legs) ===\n";
+        auto start = Clock::now();
+        for (const auto& p : pairs) graph.findShortestPath(p.first, p.second);
+        cout << fixed << setprecision(3) << "Single-criterion Dijkstra: " << elapsedMs(start) / queries << " ms avg\n";
+        
+        for (uint32_t bound : {4u, 16u, 64u}) {
+            size_t routes = 0;
+            uint64_t settled = 0, dropped = 0;
+            start = Clock::now();
+            for (const auto& p : pairs) {
+                SearchStats stats;
+                routes += graph.paretoRoutes(p.first, p.second, ByDistance | ByPrice | ByLegs, bound, &stats).size();
+                settled += stats.settledNodes;
+                dropped += stats.droppedLabels;
+            }
+            cout << "Bag bound " << setw(3) << bound << ": " << elapsedMs(start) / queries << " ms avg, "
+                 << setprecision(1) << static_cast<double>(routes) / queries << " routes, "
+                 << settled / queries << " labels settled, " << dropped / queries << " dropped\n"
+                 << setprecision(3);
+        }
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Exact tours against local search, and local search against the
+    // greedy nearest-neighbour tour, for growing stop counts
+    static void itineraries() {
+        const int side = 100;
+        mt19937 rng(37);
+        RouteGraph graph;
+        buildGeoGraph(graph, side, rng);
+        uniform_int_distribution<int> pick(1, side * side - 1);
+        
+        cout << "\n=== Itinerary benchmark (" << side * side << " cities, " << ThreadPool::shared().size()
+             << " threads) ===\n" << fixed << setprecision(1);
+        for (int stopCount : {10, 15, 60, 200}) {
+            vector<string> stops;
+            for (int i = 0; i < stopCount; i++) stops.push_back("C" + to_string(pick(rng)));
+            
+            // Greedy baseline: always go to the closest unvisited stop
+            vector<string> nodes = {"C0"};
+            nodes.insert(nodes.end(), stops.begin(), stops.end());
+            vector<vector<int>> matrix = graph.distanceMatrix(nodes, nodes);
+            vector<bool> used(nodes.size(), false);
+            long long greedy = 0;
+            for (size_t at = 0, step = 1; step < nodes.size(); step++) {
+                used[at] = true;
+                size_t next = 0;
+                for (size_t v = 1; v < nodes.size(); v++) {
+                    if (!used[v] && (next == 0 || matrix[at][v] < matrix[at][next])) next = v;
+                }
+                greedy += matrix[at][next];
+                at = next;
+            }
+            
+            auto start = Clock::now();
+            Itinerary tour = ItineraryPlanner::plan(graph, "C0", stops, false, chrono::milliseconds(100));
+            double ms = elapsedMs(start);
+            cout << setw(3) << stopCount << " stops, " << (tour.optimal ? "exact:     " : "2-opt/Or-opt:")
+                 << " " << tour.totalDistance << " km in " << ms << " ms (greedy " << greedy << " km)";
+            if (tour.optimal) {
+                start = Clock::now();
+                Itinerary local = ItineraryPlanner::plan(graph, "C0", stops, false, chrono::milliseconds(100), 0);
+                cout << "; local search " << local.totalDistance << " km in " << elapsedMs(start) << " ms";
+            }
+            cout << "\n";
+        }
+        cout.unsetf(ios::fixed);
+    }
+    
+    // k-shortest routes against one query and against textbook Yen
+    static void alternativeRoutes() {
+        const int side = 150;
+        const int queries = 20;
+        const int naiveQueries = 3;
+        const size_t k = 5;
+        mt19937 rng(41);
+        RouteGraph graph;
+        buildGeoGraph(graph, side, rng);
+        
+        uniform_int_distribution<uint32_t> pick(0, side * side - 1);
+        vector<pair<uint32_t, uint32_t>> pairs;
+        for (int i = 0; i < queries; i++) pairs.push_back({pick(rng), pick(rng)});
+        
+        cout << "\n=== K-shortest routes benchmark (" << side * side << " cities, k = " << k << ", "
+             << queries << " queries) ===\n";
+        vector<uint32_t> path;
+        SearchStats stats;
+        uint64_t singleSettled = 0, kSettled = 0;
+        auto start = Clock::now();
+        for (const auto& p : pairs) {
+            graph.shortestPathIds(p.first, p.second, path, SearchMode::Dijkstra, &stats);
+            singleSettled += stats.settledNodes;
+        }
+        double singleMs = elapsedMs(start) / queries;
+        
+        vector<vector<pair<int, vector<uint32_t>>>> results;
+        start = Clock::now();
+        for (const auto& p : pairs) {
+            results.push_back(graph.kShortestPathIds(p.first, p.second, k, &stats));
+            kSettled += stats.settledNodes;
+        }
+        double kMs = elapsedMs(start) / queries;
+        
+        int mismatches = 0;
+        start = Clock::now();
+        for (int i = 0; i < naiveQueries; i++) {
+            vector<int> expected = naiveYen(graph, pairs[i].first, pairs[i].second, k);
+            if (expected.size() != results[i].size()) mismatches++;
+            for (size_t j = 0; j < expected.size() && j < results[i].size(); j++) {
+                if (expected[j] != results[i][j].first) mismatches++;
+            }
+        }
+        double naiveMs = elapsedMs(start) / naiveQueries;
+        
+        cout << fixed << setprecision(2)
+             << "Single Dijkstra query: " << singleMs << " ms (" << singleSettled / queries << " settled)\n"
+             << "k-shortest, bounded:   " << kMs << " ms (" << kSettled / queries << " settled, "
+             << setprecision(1) << kMs / singleMs << "x one query)\n" << setprecision(2)
+             << "Textbook Yen:          " << naiveMs << " ms (" << setprecision(1) << naiveMs / kMs
+             << "x slower), mismatches: " << mismatches << "\n";
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Back-to-back queries through the reused per-thread workspace
+    static void workspaceReuse() {
+        const int side = 200;
+        const int queries = 2000;
+        mt19937 rng(5);
+        RouteGraph graph;
+        buildGeoGraph(graph, side, rng);
+        
+        vector<pair<uint32_t, uint32_t>> pairs;
+        uniform_int_distribution<uint32_t> pick(0, side * side - 1);
+        uniform_int_distribution<int> hop(1, 3);
+        for (int i = 0; i < queries; i++) {
+            // Mostly short hops, where O(V) per-query setup used to dominate
+            uint32_t a = pick(rng);
+            uint32_t b = min<uint32_t>(a + hop(rng), side * side - 1);
+            pairs.push_back({a, b});
+        }
+        
+        cout << "\n=== Query workspace benchmark (" << side * side << " cities, " << queries << " short queries) ===\n";
+        vector<uint32_t> path;
+        const pair<SearchMode, const char*> modes[] = {
+            {SearchMode::Dijkstra, "Dijkstra"},
+            {SearchMode::Bidirectional, "Bidirectional"},
+            {SearchMode::AStar, "A*"}
+        };
+        
+        for (const auto& mode : modes) {
+            // First pass grows the buffers to their high-water mark
+            for (const auto& p : pairs) {
+                graph.shortestPathIds(p.first, p.second, path, mode.first);
+            }
+            uint64_t before = QueryWorkspace::allocations();
+            auto start = Clock::now();
+            for (const auto& p : pairs) {
+                graph.shortestPathIds(p.first, p.second, path, mode.first);
+            }
+            double ms = elapsedMs(start);
+            cout << left << setw(15) << mode.second << right << fixed << setprecision(4)
+                 << " avg time: " << ms / queries << " ms"
+                 << "  workspace allocations: " << QueryWorkspace::allocations() - before << "\n";
+        }
+        cout.unsetf(ios::fixed);
+    }
+    
+    // One-to-all Dijkstra over csr with a lazy-deletion binary heap of
+    // (distance, name) pairs, as the original string-keyed search did
+    static long long stringQueueDijkstra(const CSRGraph& csr, const RouteGraph& graph, uint32_t src) {
+        unordered_map<string, int> distances;
+        priority_queue<pair<int, string>, vector<pair<int, string>>, greater<pair<int, string>>> pq;
+        distances[graph.cityName(src)] = 0;
+        pq.push({0, graph.cityName(src)});
+        long long total = 0;
+        
+        while (!pq.empty()) {
+            int currentDist = pq.top().first;
+            string current = pq.top().second;
+            pq.pop();
+            if (currentDist > distances[current]) continue;
+            total += currentDist;
+            
+            uint32_t u = graph.cityId(current);
+            for (uint32_t e = csr.offsets[u]; e < csr.offsets[u + 1]; e++) {
+                const string& next = graph.cityName(csr.targets[e]);
+                int newDist = currentDist + csr.weights[e];
+                auto it = distances.find(next);
+                if (it == distances.end() || newDist < it->second) {
+                    distances[next] = newDist;
+                    pq.push({newDist, next});
+                }
+            }
+        }
+        return total;
+    }
+    
+    // Same search with a lazy-deletion binary heap of (distance, id) pairs
+    static long long binaryQueueDijkstra(const CSRGraph& csr, uint32_t src) {
+        vector<int> distances(csr.nodeCount(), INT_MAX);
+        priority_queue<pair<int, uint32_t>, vector<pair<int, uint32_t>>, greater<pair<int, uint32_t>>> pq;
+        distances[src] = 0;
+        pq.push({0, src});
+        long long total = 0;
+        
+        while (!pq.empty()) {
+            int currentDist = pq.top().first;
+            uint32_t current = pq.top().second;
+            pq.pop();
+            if (currentDist > distances[current]) continue;
+            total += currentDist;
+            
+            for (uint32_t e = csr.offsets[current]; e < csr.offsets[current + 1]; e++) {
+                uint32_t next = csr.targets[e];
+                int newDist = currentDist + csr.weights[e];
+                if (newDist < distances[next]) {
+                    distances[next] = newDist;
+                    pq.push({newDist, next});
+                }
+            }
+        }
+        return total;
+    }
+    
+    // Same search with decrease-key on an indexed d-ary heap
+    template <unsigned Arity>
+    static long long indexedHeapDijkstra(const CSRGraph& csr, uint32_t src) {
+        vector<int> distances(csr.nodeCount(), INT_MAX);
+        IndexedDaryHeap<Arity> heap;
+        heap.resize(csr.nodeCount());
+        distances[src] = 0;
+        heap.pushOrDecrease(src, 0);
+        long long total = 0;
+        
+        while (!heap.empty()) {
+            int currentDist = heap.top().first;
+            uint32_t current = heap.top().second;
+            heap.pop();
+            total += currentDist;
+            
+            for (uint32_t e = csr.offsets[current]; e < csr.offsets[current + 1]; e++) {
+                uint32_t next = csr.targets[e];
+                int newDist = currentDist + csr.weights[e];
+                if (newDist < distances[next]) {
+                    distances[next] = newDist;
+                    heap.pushOrDecrease(next, newDist);
+                }
+            }
+        }
+        return total;
+    }
+    
+    // Priority queue variants on one-to-all searches over a random graph
+    static void priorityQueues() {
+        const uint32_t nodes = 200000;
+        const uint32_t edgesPerNode = 4;
+        const int sources = 5;
+        mt19937 rng(13);
+        uniform_int_distribution<uint32_t> pick(0, nodes - 1);
+        uniform_int_distribution<int> weight(1, 1000);
+        
+        RouteGraph graph;
+        for (uint32_t i = 0; i < nodes; i++) {
+            // A ring keeps the graph connected; the rest are random chords
+            graph.addRoute("C" + to_string(i), "C" + to_string((i + 1) % nodes), weight(rng));
+            for (uint32_t k = 1; k < edgesPerNode / 2; k++) {
+                graph.addRoute("C" + to_string(i), "C" + to_string(pick(rng)), weight(rng));
+            }
+        }
+        graph.freeze();
+        
+        cout << "\n=== Priority queue benchmark (" << nodes << " nodes, " << sources << " one-to-all searches) ===\n";
+        auto report = [&](const char* label, const function<long long(uint32_t)>& search) {
+            long long checksum = 0;
+            auto start = Clock::now();
+            for (int i = 0; i < sources; i++) checksum += search(i * 997);
+            cout << left << setw(28) << label << right << fixed << setprecision(1)
+                 << elapsedMs(start) / sources << " ms/search  (checksum " << checksum << ")\n";
+        };
+        const CSRGraph& g = graph.adjacency();
+        report("priority_queue<int,string>", [&](uint32_t s) { return stringQueueDijkstra(g, graph, s); });
+        report("priority_queue<int,id>", [&](uint32_t s) { return binaryQueueDijkstra(g, s); });
+        report("IndexedDaryHeap<2>", [&](uint32_t s) { return indexedHeapDijkstra<2>(g, s); });
+        report("IndexedDaryHeap<4>", [&](uint32_t s) { return indexedHeapDijkstra<4>(g, s); });
+        report("IndexedDaryHeap<8>", [&](uint32_t s) { return indexedHeapDijkstra<8>(g, s); });
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Reader threads querying snapshots while a writer publishes batches
+    static void concurrentQueries() {
+        const int side = 150;
+        const int readers = 4;
+        const int batches = 20;
+        mt19937 rng(17);
+        
+        QueryEngine engine;
+        QueryEngine::UpdateBatch initial;
+        uniform_real_distribution<double> popularity(1.0, 10.0);
+        for (int i = 0; i < side * side; i++) {
+            initial.insertCity(City("C" + to_string(i), "Synthetic", popularity(rng)));
+        }
+        for (int r = 0; r < side; r++) {
+            for (int c = 0; c < side; c++) {
+                int id = r * side + c;
+                if (c + 1 < side) initial.addRoute("C" + to_string(id), "C" + to_string(id + 1), 50 + rng() % 100);
+                if (r + 1 < side) initial.addRoute("C" + to_string(id), "C" + to_string(id + side), 50 + rng() % 100);
+            }
+        }
+        engine.apply(initial);
+        
+        cout << "\n=== Concurrent query benchmark (" << side * side << " cities, " << readers
+             << " readers, " << batches << " writer batches per query type) ===\n";
+        atomic<int> failures{0};
+        double publishMs = 0;
+        
+        // Readers run only `query` while the writer publishes batches, so
+        // each query type gets its own rate
+        auto phase = [&](const char* label, auto query) {
+            atomic<bool> done{false};
+            atomic<long long> count{0};
+            vector<thread> threads;
+            auto start = Clock::now();
+            for (int t = 0; t < readers; t++) {
+                threads.emplace_back([&, t] {
+                    mt19937 local(100 + t);
+                    uniform_int_distribution<int> pick(0, side * side - 1);
+                    long long queries = 0;
+                    while (!done) {
+                        shared_ptr<const PlannerSnapshot> snap = engine.snapshot();
+                        if (!query(*snap, "C" + to_string(pick(local)), "C" + to_string(pick(local)))) failures++;
+                        queries++;
+                    }
+                    count += queries;
+                });
+            }
+            for (int b = 0; b < batches; b++) {
+                QueryEngine::UpdateBatch batch;
+                for (int k = 0; k < 100; k++) {
+                    batch.addRoute("C" + to_string(rng() % (side * side)), "C" + to_string(rng() % (side * side)),
+                                   200 + rng() % 500);
+                }
+                batch.insertCity(City("New" + to_string(engine.snapshot()->version()), "Synthetic", popularity(rng)));
+                auto publishStart = Clock::now();
+                engine.apply(batch);
+                publishMs += elapsedMs(publishStart);
+                this_thread::sleep_for(chrono::milliseconds(50));
+            }
+            done = true;
+            for (auto& thread : threads) thread.join();
+            double seconds = elapsedMs(start) / 1000.0;
+            cout << left << setw(16) << label << right << fixed << setprecision(0) << count / seconds << " queries/s\n";
+        };
+        
+        phase("Route queries", [](const PlannerSnapshot& snap, const string& a, const string& b) {
+            return snap.findShortestPath(a, b, SearchMode::Bidirectional).first >= 0;
+        });
+        phase("City lookups", [](const PlannerSnapshot& snap, const string& a, const string&) {
+            return snap.findCity(a) != nullptr;
+        });
+        phase("Top-10 queries", [](const PlannerSnapshot& snap, const string&, const string&) {
+            return snap.topDestinations(10).size() == 10;
+        });
+        
+        cout << setprecision(2) << "Avg publish time: " << publishMs / (3 * batches) << " ms, final version "
+             << engine.snapshot()->version() << ", failed queries: " << failures << "\n";
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Skewed query mix with and without the route cache, across the pool
+    static void routeCache() {
+        const int side = 100;
+        const int hotPairs = 200;
+        const int queries = 4000;
+        mt19937 rng(23);
+        RouteGraph graph;
+        buildGeoGraph(graph, side, rng);
+        
+        // 90% of queries go to a few hundred pairs, in either direction
+        uniform_int_distribution<uint32_t> pick(0, side * side - 1);
+        vector<pair<string, string>> hot(hotPairs);
+        for (auto& p : hot) p = {"C" + to_string(pick(rng)), "C" + to_string(pick(rng))};
+        vector<pair<string, string>> workload(queries);
+        for (auto& q : workload) {
+            if (rng() % 10 != 0) {
+                q = hot[rng() % hotPairs];
+                if (rng() % 2) swap(q.first, q.second);
+            } else {
+                q = {"C" + to_string(pick(rng)), "C" + to_string(pick(rng))};
+            }
+        }
+        
+        cout << "\n=== Route cache benchmark (" << side * side << " cities, " << queries << " queries, "
+             << hotPairs << " hot pairs, " << ThreadPool::shared().size() << " threads) ===\n";
+        vector<int> expected(queries), cached(queries);
+        auto run = [&](vector<int>& out) {
+            auto start = Clock::now();
+            ThreadPool::shared().parallelFor(queries, [&](size_t i, unsigned) {
+                out[i] = graph.findShortestPath(workload[i].first, workload[i].second,
+                                                SearchMode::Bidirectional).first;
+            });
+            return elapsedMs(start);
+        };
+        
+        double uncachedMs = run(expected);
+        graph.enableRouteCache(512, 16);
+        double cachedMs = run(cached);
+        int mismatches = 0;
+        for (int i = 0; i < queries; i++) {
+            if (expected[i] != cached[i]) mismatches++;
+        }
+        RouteCacheStats warm = graph.routeCacheStats();
+        
+        // A new route changes the version; every entry must be recomputed
+        graph.addRoute("C0", "C" + to_string(side * side - 1), 1);
+        graph.freeze();
+        run(cached);
+        RouteCacheStats after = graph.routeCacheStats();
+        
+        cout << fixed << setprecision(2)
+             << "Uncached: " << uncachedMs << " ms  cached: " << cachedMs << " ms  ("
+             << uncachedMs / cachedMs << "x), mismatches: " << mismatches << "\n"
+             << "Hits: " << warm.hits << "  misses: " << warm.misses << "  evictions: " << warm.evictions
+             << "  hit rate: " << setprecision(1) << warm.hitRate() * 100 << "%\n"
+             << "After addRoute: " << after.invalidations << " entries invalidated, "
+             << after.misses - warm.misses << " misses on the next pass\n";
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Route updates against rebuilding: cache entries kept, update latency
+    // and fully re-contracting the hierarchy in its previous order
+    static void dynamicUpdates() {
+        const int side = 120;
+        const int queries = 3000;
+        const int updatesPerKind = 10;
+        mt19937 rng(24);
+        RouteGraph graph;
+        auto start = Clock::now();
+        buildGeoGraph(graph, side, rng);
+        double loadMs = elapsedMs(start);
+        graph.enableRouteCache(8192, 16);
+        start = Clock::now();
+        graph.buildContractionHierarchy();
+        double contractMs = elapsedMs(start);
+        
+        uniform_int_distribution<uint32_t> pick(0, side * side - 1);
+        vector<pair<string, string>> workload(queries);
+        for (auto& q : workload) q = {"C" + to_string(pick(rng)), "C" + to_string(pick(rng))};
+        auto warm = [&]() {
+            ThreadPool::shared().parallelFor(queries, [&](size_t i, unsigned) {
+                graph.findShortestPath(workload[i].first, workload[i].second, SearchMode::Bidirectional);
+            });
+        };
+        warm();
+        
+        cout << "\n=== Dynamic route update benchmark (" << side * side << " cities, " << graph.routeCount()
+             << " routes, " << queries << " cached pairs) ===\n" << fixed << setprecision(3);
+        const char* kinds[] = {"Longer", "Shorter", "Closed"};
+        graph.freeze();
+        for (int kind = 0; kind < 3; kind++) {
+            double updateMs = 0;
+            uint64_t dropped = 0, entries = 0;
+            for (int i = 0; i < updatesPerKind; i++) {
+                // A horizontal neighbour pair, which always has a road
+                uint32_t r = pick(rng) % side, c = pick(rng) % (side - 1);
+                string a = "C" + to_string(r * side + c), b = "C" + to_string(r * side + c + 1);
+                RouteAttributes route;
+                if (!graph.findRoute(a, b, TravelMode::Road, route)) continue;
+                
+                RouteCacheStats before = graph.routeCacheStats();
+                start = Clock::now();
+                if (kind == 2) {
+                    graph.removeRoute(a, b, TravelMode::Road);
+                    graph.freeze(); // the CSR rebuild is part of a closure
+                } else {
+                    route.distance = kind == 0 ? route.distance * 3 : max(1, route.distance / 3);
+                    graph.updateRoute(a, b, route);
+                }
+                updateMs += elapsedMs(start);
+                dropped += graph.routeCacheStats().invalidations - before.invalidations;
+                entries += before.entries;
+                warm();
+            }
+            cout << left << setw(8) << kinds[kind] << right << " update: " << setw(8) << updateMs / updatesPerKind
+                 << " ms, cache entries kept: " << setprecision(1)
+                 << 100.0 * (entries - dropped) / max<uint64_t>(entries, 1) << "% (wholesale: 0%)\n"
+                 << setprecision(3);
+        }
+        
+        RouteGraph rebuilt;
+        start = Clock::now();
+        buildGeoGraph(rebuilt, side, rng);
+        double reloadMs = elapsedMs(start);
+        
+        // A price-only update must leave a hierarchy stale when earlier
+        // distance changes already made it so
+        int staleMismatches = 0;
+        auto priceOnly = [&](RouteGraph& g, const string& a, const string& b) {
+            RouteAttributes route;
+            if (g.findRoute(a, b, TravelMode::Road, route)) {
+                route.price += 10;
+                g.updateRoute(a, b, route);
+            }
+        };
+        auto checkHierarchy = [&](const RouteGraph& g, const string& a, const string& b) {
+            if (g.findShortestPath(a, b, SearchMode::Hierarchy).first !=
+                g.findShortestPath(a, b, SearchMode::Dijkstra).first) staleMismatches++;
+        };
+        RouteGraph stale = graph;
+        stale.disableRouteCache();
+        priceOnly(stale, "C0", "C1");
+        for (int i = 0; i < 100; i++) checkHierarchy(stale, workload[i].first, workload[i].second);
+        
+        start = Clock::now();
+        graph.refreshContractionHierarchy();
+        double refreshMs = elapsedMs(start);
+        
+        // Nor may it revive a hierarchy built before a city was added
+        RouteGraph grown = graph;
+        grown.disableRouteCache();
+        grown.addRoute("C0", "Outpost", RouteAttributes::byRoad(5));
+        priceOnly(grown, "C0", "Outpost");
+        checkHierarchy(grown, "C0", "Outpost");
+        checkHierarchy(grown, "Outpost", workload[0].second);
+        
+        RouteGraph plain = graph;
+        plain.disableRouteCache();
+        int mismatches = 0;
+        for (int i = 0; i < 300; i++) {
+            const auto& q = workload[i];
+            int expected = plain.findShortestPath(q.first, q.second, SearchMode::Dijkstra).first;
+            if (graph.findShortestPath(q.first, q.second, SearchMode::Bidirectional).first != expected ||
+                plain.findShortestPath(q.first, q.second, SearchMode::Hierarchy).first != expected) mismatches++;
+        }
+        
+        cout << setprecision(1) << "Full reload instead: " << reloadMs << " ms (initial load " << loadMs << " ms)\n"
+             << "Hierarchy: full contraction " << contractMs << " ms, full re-contraction in previous order " << refreshMs
+             << " ms (" << contractMs / refreshMs << "x)\n"
+             << "Mismatches against Dijkstra (cached and hierarchy): " << mismatches
+             << ", after price-only updates: " << staleMismatches << "\n";
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Copying listings against iterators, views and visitors
+    static void cityListings() {
+        const int cityCount = 1000000;
+        mt19937 rng(19);
+        uniform_real_distribution<double> popularity(1.0, 10.0);
+        CityIndex index;
+        CityHeap heap;
+        
+        for (int i = 0; i < cityCount; i++) {
+            City city("City" + to_string(rng()), "Country" + to_string(i % 200), popularity(rng));
+            city.addHotel(Hotel("Grand Hotel " + city.name, 4.5, 200));
+            city.addHotel(Hotel("Budget Inn " + city.name, 3.9, 60));
+            city.addAttraction(Attraction("Old Town of " + city.name, 4.6, "Historical"));
+            city.addAttraction(Attraction("Museum of " + city.name, 4.4, "Museum"));
+            index.insertCity(city);
+            heap.insertCity(city);
+        }
+        
+        cout << "\n=== City listing benchmark (" << index.size() << " cities) ===\n";
+        size_t checksum = 0;
+        auto start = Clock::now();
+        vector<City> copied = index.getAllCities();
+        for (const City& city : copied) checksum += city.name.size();
+        double copyMs = elapsedMs(start);
+        copied.clear();
+        copied.shrink_to_fit();
+        
+        start = Clock::now();
+        for (const City& city : index) checksum += city.name.size();
+        double iterMs = elapsedMs(start);
+        
+        start = Clock::now();
+        index.forEachCity([&](const City& city) { checksum += city.name.size(); });
+        double visitMs = elapsedMs(start);
+        
+        start = Clock::now();
+        for (const auto& entry : heap.entries()) checksum += entry.cityId;
+        double viewMs = elapsedMs(start);
+        
+        const int topN = 10, repeats = 20;
+        start = Clock::now();
+        for (int r = 0; r < repeats; r++) {
+            CityHeap tempHeap = heap; // copy-and-pop, as getTopNDestinations once did
+            for (int i = 0; i < topN && !tempHeap.isEmpty(); i++) {
+                checksum += tempHeap.getTopDestination().first.size();
+            }
+        }
+        double heapCopyMs = elapsedMs(start) / repeats;
+        
+        start = Clock::now();
+        for (int r = 0; r < repeats; r++) {
+            heap.forEachTopDestination(topN, [&](const string& name, double) { checksum += name.size(); });
+        }
+        double frontierMs = elapsedMs(start) / repeats;
+        
+        cout << fixed << setprecision(2)
+             << "getAllCities (copy):          " << copyMs << " ms\n"
+             << "in-order iterator:            " << iterMs << " ms\n"
+             << "forEachCity visitor:          " << visitMs << " ms\n"
+             << "CityHeap::entries() view:     " << viewMs << " ms\n"
+             << "top-" << topN << " via heap copy:         " << heapCopyMs << " ms\n"
+             << "top-" << topN << " via forEachTopDest.:   " << setprecision(4) << frontierMs << " ms\n"
+             << "(checksum " << checksum << ")\n";
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Streaming popularity updates interleaved with top-K queries
+    static void topDestinations() {
+        const int cityCount = 1000000;
+        const int updates = 2000000;
+        const int queryEvery = 1000;
+        const int topK = 100;
+        mt19937 rng(23);
+        uniform_real_distribution<double> score(0.0, 10.0);
+        uniform_real_distribution<double> drift(-0.5, 0.5);
+        
+        CityHeap heap;
+        heap.reserve(cityCount);
+        vector<string> names;
+        for (int i = 0; i < cityCount; i++) {
+            names.push_back("City" + to_string(i));
+            heap.insertCity(City(names.back(), "", score(rng)));
+        }
+        
+        cout << "\n=== Top-K benchmark (" << cityCount << " cities, " << updates << " updates, top-"
+             << topK << " every " << queryEvery << " updates) ===\n";
+        double checksum = 0;
+        double queryMs = 0;
+        auto start = Clock::now();
+        for (int i = 0; i < updates; i++) {
+            const string& name = names[rng() % cityCount];
+            heap.updatePopularity(name, heap.popularityOf(name) + drift(rng));
+            if (i % queryEvery == 0) {
+                auto queryStart = Clock::now();
+                heap.forEachTopDestination(topK, [&](const string&, double p) { checksum += p; });
+                queryMs += elapsedMs(queryStart);
+            }
+        }
+        double totalMs = elapsedMs(start);
+        int queries = updates / queryEvery;
+        
+        cout << fixed << setprecision(3)
+             << "Avg update: " << (totalMs - queryMs) * 1000.0 / updates << " us"
+             << "  avg top-" << topK << " query: " << queryMs / queries << " ms"
+             << "  (checksum " << setprecision(1) << checksum << ")\n";
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Ingest throughput of the catalog importer on generated files
+    static void catalogImport() {
+        const int cityCount = 200000;
+        const int hotelsPerCity = 5;
+        const int attractionsPerCity = 5;
+        const int routeCount = 500000;
+        mt19937 rng(29);
+        
+        string directory = (filesystem::temp_directory_path() / "travel_planner_import_bench").string();
+        filesystem::create_directories(directory);
+        {
+            ofstream cities(directory + "/cities.csv"), hotels(directory + "/hotels.tsv");
+            ofstream attractions(directory + "/attractions.csv"), routes(directory + "/routes.csv");
+            cities << "name,country,popularity,latitude,longitude\n";
+            hotels << "city\tname\trating\tprice\n";
+            attractions << "city,name,rating,type\n";
+            routes << "city1,city2,distance\n";
+            for (int i = 0; i < cityCount; i++) {
+                string name = "City" + to_string(i);
+                cities << name << ",Country" << i % 150 << "," << (rng() % 1000) / 100.0 << ","
+                       << (rng() % 18000) / 100.0 - 90 << "," << (rng() % 36000) / 100.0 - 180 << "\n";
+                for (int h = 0; h < hotelsPerCity; h++) {
+                    hotels << name << "\tHotel " << h << " of " << name << "\t" << 3 + (rng() % 20) / 10.0
+                           << "\t" << 40 + rng() % 500 << "\n";
+                }
+                for (int a = 0; a < attractionsPerCity; a++) {
+                    attractions << name << ",Sight " << a << " of " << name << "," << 3 + (rng() % 20) / 10.0
+                                << ",Landmark\n";
+                }
+            }
+            for (int r = 0; r < routeCount; r++) {
+                routes << "City" << rng() % cityCount << ",City" << rng() % cityCount << "," << 10 + rng() % 3000 << "\n";
+            }
+        }
+        
+        CityIndex index;
+        CityHeap heap;
+        RouteGraph graph;
+        CatalogImporter::Stats stats = CatalogImporter::load(directory, index, heap, graph);
+        filesystem::remove_all(directory);
+        
+        cout << "\n=== Catalog import benchmark ===\n" << fixed << setprecision(0)
+             << stats.cities << " cities, " << stats.hotels << " hotels, " << stats.attractions
+             << " attractions, " << stats.routes << " routes (" << stats.rejected << " rejected)\n"
+             << setprecision(2) << "Total: " << stats.seconds << " s, "
+             << setprecision(0) << stats.rows() / stats.seconds << " rows/s\n";
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Startup cost of rebuilding the catalog against mapping a snapshot
+    static void snapshotStartup() {
+        const int cityCount = 100000;
+        const int routeCount = 400000;
+        const string path = "snapshot_benchmark.snap";
+        mt19937 rng(31);
+        
+        vector<City> cities;
+        vector<RouteEdge> routes;
+        for (int i = 0; i < cityCount; i++) {
+            City city("City" + to_string(i), "Country" + to_string(i % 150), (rng() % 1000) / 100.0);
+            city.addHotel(Hotel("Hotel " + to_string(i), 4.0, 100));
+            city.addAttraction(Attraction("Sight " + to_string(i), 4.5, "Landmark"));
+            cities.push_back(city);
+        }
+        for (int i = 0; i < routeCount; i++) {
+            routes.push_back({static_cast<uint32_t>(rng() % cityCount), static_cast<uint32_t>(rng() % cityCount),
+                              static_cast<int>(10 + rng() % 3000)});
+        }
+        
+        auto start = Clock::now();
+        CityIndex index;
+        CityHeap heap;
+        RouteGraph graph;
+        heap.reserve(cityCount);
+        graph.reserve(cityCount, routeCount);
+        for (const auto& city : cities) {
+            index.insertCity(city);
+            heap.insertCity(city);
+        }
+        for (const auto& route : routes) {
+            graph.addRoute(cities[route.from].name, cities[route.to].name, route.distance);
+        }
+        graph.freeze();
+        double rebuildMs = elapsedMs(start);
+        
+        start = Clock::now();
+        bool written = SnapshotWriter().write(path, index, heap, graph);
+        double writeMs = elapsedMs(start);
+        
+        MappedSnapshot mapped;
+        start = Clock::now();
+        bool opened = mapped.open(path, false);
+        double mapMs = elapsedMs(start);
+        start = Clock::now();
+        bool verified = mapped.open(path);
+        double verifyMs = elapsedMs(start);
+        
+        int mismatches = 0;
+        uniform_int_distribution<int> pick(0, cityCount - 1);
+        for (int i = 0; i < 50 && opened && verified; i++) {
+            const string& a = cities[pick(rng)].name;
+            const string& b = cities[pick(rng)].name;
+            if (graph.findShortestPath(a, b).first != mapped.findShortestPath(a, b).first) mismatches++;
+        }
+        remove(path.c_str());
+        
+        cout << "\n=== Snapshot startup benchmark (" << cityCount << " cities, " << routeCount << " routes) ===\n"
+             << fixed << setprecision(2)
+             << "Rebuild: " << rebuildMs << " ms, write snapshot: " << writeMs << " ms"
+             << (written ? "" : " (FAILED)") << "\n"
+             << "Map: " << mapMs << " ms, map + checksum: " << verifyMs << " ms"
+             << (opened && verified ? "" : " (FAILED)") << "\n"
+             << "Path mismatches: " << mismatches << "\n";
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Trip store compaction, reload and log append throughput
+    static void tripStore() {
+        const int tripCount = 1000000;
+        const int logged = 2000;  // each append is fsynced
+        const string path = "trip_store_benchmark.dat";
+        mt19937 rng(37);
+        
+        CityInterner names;
+        for (int i = 0; i < 5000; i++) names.intern("City" + to_string(i));
+        deque<Trip> history, upcoming;
+        vector<Trip> all;
+        for (int i = 0; i < tripCount; i++) {
+            Trip trip(rng() % 5000, rng() % 5000, rng() % 10000, rng() % 2000, 20000 + rng() % 1000,
+                      i % 2 ? TripStatus::Completed : TripStatus::Planned);
+            (i % 2 ? history : upcoming).push_back(trip);
+            all.push_back(trip);
+        }
+        
+        TripStore store(path);
+        auto start = Clock::now();
+        bool saved = store.save(names, history, upcoming, all);
+        double saveMs = elapsedMs(start);
+        
+        start = Clock::now();
+        for (int i = 0; i < logged; i++) {
+            store.append(TripStore::Op::Plan, all[i], names);
+        }
+        double appendMs = elapsedMs(start);
+        
+        TripStore::State state;
+        CityInterner loadedNames;
+        start = Clock::now();
+        bool loaded = store.load(state, loadedNames);
+        double loadMs = elapsedMs(start);
+        bool matches = loaded && state.all.size() == all.size() + logged &&
+                       state.history.size() == history.size() && state.upcoming.size() == upcoming.size() + logged;
+        remove(path.c_str());
+        remove((path + ".log").c_str());
+        
+        cout << "\n=== Trip store benchmark (" << tripCount * 2 << " trip records) ===\n"
+             << fixed << setprecision(1)
+             << "Compacting save: " << saveMs << " ms" << (saved ? "" : " (FAILED)") << "\n"
+             << "Log append (synced): " << setprecision(2) << appendMs * 1000 / logged << " us/record\n"
+             << "Load + replay: " << setprecision(1) << loadMs << " ms" << (matches ? "" : " (MISMATCH)") << "\n";
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Trip sorting on adversarial inputs: legacy sorters vs TripSorter
+    static void tripSorting() {
+        const int smallCount = 20000;     // the legacy quicksort is quadratic here
+        const int largeCount = 4000000;
+        mt19937 rng(41);
+        
+        auto makeTrips = [&](int count, int shape) {
+            vector<Trip> trips(count);
+            for (int i = 0; i < count; i++) {
+                int cost = shape == 0 ? i : shape == 1 ? 500 : shape == 2 ? count - i : static_cast<int>(rng() % 5000);
+                trips[i] = Trip(rng() % 1000, rng() % 1000, rng() % 20000, cost, 19000 + rng() % 2000);
+            }
+            return trips;
+        };
+        // Reference order: std::stable_sort of the index permutation
+        auto referenceOrder = [](const vector<Trip>& trips, const vector<TripKey>& keys) {
+            vector<uint32_t> order(trips.size());
+            for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+            stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+                for (TripKey key : keys) {
+                    int32_t x = key == TripKey::Cost ? trips[a].cost : key == TripKey::Distance ? trips[a].distance : trips[a].day;
+                    int32_t y = key == TripKey::Cost ? trips[b].cost : key == TripKey::Distance ? trips[b].distance : trips[b].day;
+                    if (x != y) return x < y;
+                }
+                return false;
+            });
+            return order;
+        };
+        // The legacy sorters order by one key and need not be stable
+        auto sameKeys = [](const vector<Trip>& sorted, const vector<Trip>& trips, const vector<uint32_t>& reference,
+                           int32_t Trip::*field) {
+            for (size_t i = 0; i < sorted.size(); i++) {
+                if (sorted[i].*field != trips[reference[i]].*field) return false;
+            }
+            return true;
+        };
+        
+        const char* shapes[] = {"sorted", "all-equal", "reversed", "random"};
+        const vector<TripKey> keys = {TripKey::Cost, TripKey::Distance, TripKey::Date};
+        cout << "\n=== Trip sorting benchmark ===\n" << fixed << setprecision(2);
+        for (int shape = 0; shape < 4; shape++) {
+            vector<Trip> small = makeTrips(smallCount, shape);
+            vector<Trip> copy = small;
+            auto start = Clock::now();
+            legacyQuickSortByCost(copy, 0, copy.size() - 1);
+            double quickMs = elapsedMs(start);
+            bool correct = sameKeys(copy, small, referenceOrder(small, {TripKey::Cost}), &Trip::cost);
+            copy = small;
+            start = Clock::now();
+            legacyMergeSortByDistance(copy, 0, copy.size() - 1);
+            double mergeMs = elapsedMs(start);
+            correct = correct && sameKeys(copy, small, referenceOrder(small, {TripKey::Distance}), &Trip::distance);
+            start = Clock::now();
+            vector<uint32_t> order = TripSorter::sortedOrder(small, keys);
+            double engineMs = elapsedMs(start);
+            correct = correct && order == referenceOrder(small, keys);
+            
+            vector<Trip> large = makeTrips(largeCount, shape);
+            start = Clock::now();
+            vector<uint32_t> largeOrder = TripSorter::sortedOrder(large, keys);
+            double largeMs = elapsedMs(start);
+            start = Clock::now();
+            vector<uint32_t> largeReference = referenceOrder(large, keys);
+            double stableMs = elapsedMs(start);
+            correct = correct && largeOrder == largeReference;
+            
+            cout << left << setw(10) << shapes[shape] << right
+                 << " " << smallCount << " trips: quicksort " << setw(8) << quickMs << " ms, merge sort "
+                 << setw(6) << mergeMs << " ms, TripSorter " << setw(5) << engineMs << " ms | "
+                 << largeCount << " trips: " << setw(7) << largeMs << " ms (stable_sort " << setw(7) << stableMs
+                 << " ms)" << (correct ? "" : " (MISMATCH)") << "\n";
+        }
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Report aggregations: array-of-structs loops vs TripColumns kernels
+    static void tripReports() {
+        const int tripCount = 10000000;
+        const int rounds = 10;
+        mt19937 rng(43);
+        
+        vector<Trip> trips(tripCount);
+        TripColumns table;
+        table.reserve(tripCount);
+        for (int i = 0; i < tripCount; i++) {
+            trips[i] = Trip(rng() % 200, rng() % 200, rng() % 15000, rng() % 3000, 19000 + rng() % 1500,
+                            static_cast<TripStatus>(rng() % 3));
+            table.append(trips[i]);
+        }
+        
+        TripFilter filter;
+        filter.fromDay = 19500;
+        filter.toDay = 20000;
+        filter.statuses = TripFilter::only(TripStatus::Completed);
+        
+        auto start = Clock::now();
+        int64_t structSum = 0;
+        size_t structCount = 0;
+        for (int r = 0; r < rounds; r++) {
+            for (const auto& trip : trips) {
+                if (trip.day >= filter.fromDay && trip.day <= filter.toDay && trip.status == TripStatus::Completed) {
+                    structSum += trip.cost;
+                    structCount++;
+                }
+            }
+        }
+        double structMs = elapsedMs(start) / rounds;
+        
+        start = Clock::now();
+        TripColumns::Aggregate columnar;
+        for (int r = 0; r < rounds; r++) columnar = table.aggregate(TripColumns::Column::Cost, filter);
+        double columnMs = elapsedMs(start) / rounds;
+        
+        start = Clock::now();
+        vector<TripColumns::Aggregate> batch;
+        for (int r = 0; r < rounds; r++) {
+            batch = table.aggregate({TripColumns::Column::Cost, TripColumns::Column::Distance, TripColumns::Column::Day}, filter);
+        }
+        double batchMs = elapsedMs(start) / rounds;
+        
+        start = Clock::now();
+        size_t months = table.groupByMonth(TripColumns::Column::Cost).size();
+        double monthMs = elapsedMs(start);
+        start = Clock::now();
+        size_t routes = table.groupByRoute(TripColumns::Column::Cost).size();
+        double routeMs = elapsedMs(start);
+        
+        bool matches = structSum / rounds == columnar.sum && structCount / rounds == columnar.count &&
+                       batch[0].sum == columnar.sum;
+        cout << "\n=== Trip report benchmark (" << tripCount << " trips) ===\n" << fixed << setprecision(2)
+             << "Filtered sum, array of structs: " << structMs << " ms\n"
+             << "Filtered sum, columnar:         " << columnMs << " ms" << (matches ? "" : " (MISMATCH)") << "\n"
+             << "Three aggregates, one filter:   " << batchMs << " ms\n"
+             << "Group by month: " << monthMs << " ms (" << months << " months), by route: "
+             << routeMs << " ms (" << routes << " routes)\n";
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Scheduler operations at scale, and cancel-by-drain on a FIFO queue
+    static void tripScheduler() {
+        const int tripCount = 2000000;
+        const int operations = 200000;
+        const int queueTrips = 100000;
+        const int queueCancels = 200;
+        mt19937 rng(47);
+        
+        TripScheduler scheduler;
+        vector<uint32_t> ids;
+        auto start = Clock::now();
+        for (int i = 0; i < tripCount; i++) {
+            ids.push_back(scheduler.schedule(Trip(i % 500, i % 499, 1000, 100, 20000 + rng() % 3650)));
+        }
+        double insertMs = elapsedMs(start);
+        
+        start = Clock::now();
+        for (int i = 0; i < operations; i++) {
+            uint32_t id = ids[rng() % ids.size()];
+            if (i % 2) scheduler.reschedule(id, 20000 + rng() % 3650);
+            else scheduler.cancel(id);
+        }
+        double updateMs = elapsedMs(start);
+        
+        start = Clock::now();
+        size_t inRange = 0;
+        for (int q = 0; q < 100; q++) {
+            int32_t from = 20000 + rng() % 3600;
+            scheduler.forEachInRange(from, from + 7, [&](uint32_t, const Trip&) { inRange++; });
+        }
+        double rangeMs = elapsedMs(start) / 100;
+        
+        start = Clock::now();
+        vector<Trip> due;
+        size_t batches = 0;
+        for (int32_t day = 20000; day < 20000 + 3650 && !scheduler.empty(); day += 30, batches++) {
+            due.clear();
+            scheduler.popDue(day, due);
+        }
+        double dueMs = elapsedMs(start);
+        
+        // Baseline: cancelling a trip in a FIFO queue means draining it
+        queue<Trip> fifo;
+        for (int i = 0; i < queueTrips; i++) fifo.push(Trip(0, 0, 0, 0, i));
+        start = Clock::now();
+        for (int c = 0; c < queueCancels; c++) {
+            int32_t target = rng() % queueTrips;
+            queue<Trip> kept;
+            while (!fifo.empty()) {
+                if (fifo.front().day != target) kept.push(fifo.front());
+                fifo.pop();
+            }
+            fifo.swap(kept);
+        }
+        double drainUs = elapsedMs(start) * 1000 / queueCancels;
+        
+        cout << "\n=== Trip scheduler benchmark (" << tripCount << " trips) ===\n" << fixed << setprecision(3)
+             << "Insert: " << insertMs * 1e6 / tripCount << " ns/trip\n"
+             << "Cancel/reschedule by ID: " << updateMs * 1e6 / operations << " ns/op\n"
+             << "One-week range query: " << rangeMs << " ms (" << inRange / 100 << " trips)\n"
+             << "Pop due in " << batches << " monthly batches: " << dueMs << " ms\n"
+             << "FIFO queue cancel-by-drain (" << queueTrips << " trips): " << drainUs << " us/op\n";
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Taking a history view: copying a std::stack vs a persistent snapshot
+    static void historySnapshots() {
+        const int tripCount = 1000000;
+        const int views = 20;
+        
+        stack<Trip> copied;
+        PersistentStack<Trip> shared;
+        for (int i = 0; i < tripCount; i++) {
+            Trip trip(i % 100, i % 99, 500, 50, 19000 + i % 2000, TripStatus::Completed);
+            copied.push(trip);
+            shared = shared.push(trip);
+        }
+        
+        // Each view reads the first page, as the history screen does
+        auto start = Clock::now();
+        int64_t checksum = 0;
+        for (int v = 0; v < views; v++) {
+            stack<Trip> view = copied;
+            for (int i = 0; i < 5; i++, view.pop()) checksum += view.top().day;
+        }
+        double copyMs = elapsedMs(start) / views;
+        
+        start = Clock::now();
+        for (int v = 0; v < views; v++) {
+            PersistentStack<Trip> view = shared;
+            int i = 0;
+            for (auto it = view.begin(); it != view.end() && i < 5; ++it, i++) checksum -= it->day;
+        }
+        double snapshotUs = elapsedMs(start) * 1000 / views;
+        
+        start = Clock::now();
+        PersistentStack<Trip> popped = shared;
+        for (int i = 0; i < tripCount / 2; i++) popped = popped.pop();
+        for (int i = 0; i < tripCount / 2; i++) popped = popped.push(Trip());
+        double undoRedoNs = elapsedMs(start) * 1e6 / tripCount;
+        
+        cout << "\n=== History snapshot benchmark (" << tripCount << " trips) ===\n" << fixed << setprecision(3)
+             << "std::stack copy per view: " << copyMs << " ms\n"
+             << "Persistent snapshot per view: " << snapshotUs << " us" << (checksum == 0 ? "" : " (MISMATCH)") << "\n"
+             << "Pop/push (undo/redo step): " << undoRedoNs << " ns\n";
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Run a benchmark by name, or every benchmark for "all"
+    static bool run(const string& name) {
+        bool all = name == "all";
+        bool found = false;
+        if (all || name == "search") { searchModes(); found = true; }
+        if (all || name == "ch") { contractionHierarchy(); found = true; }
+        if (all || name == "alt") { landmarkSearch(); found = true; }
+        if (all || name == "matrix") { distanceMatrix(); found = true; }
+        if (all || name == "workspace") { workspaceReuse(); found = true; }
+        if (all || name == "heap") { priorityQueues(); found = true; }
+        if (all || name == "within") { boundedSearches(); found = true; }
+        if (all || name == "pareto") { paretoSearch(); found = true; }
+        if (all || name == "tour") { itineraries(); found = true; }
+        if (all || name == "kpaths") { alternativeRoutes(); found = true; }
+        if (all || name == "cache") { routeCache(); found = true; }
+        if (all || name == "updates") { dynamicUpdates(); found = true; }
+        if (all || name == "concurrent") { concurrentQueries(); found = true; }
+        if (all || name == "listing") { cityListings(); found = true; }
+        if (all || name == "topk") { topDestinations(); found = true; }
+        if (all || name == "import") { catalogImport(); found = true; }
+        if (all || name == "snapshot") { snapshotStartup(); found = true; }
+        if (all || name == "trips") { tripStore(); found = true; }
+        if (all || name == "sort") { tripSorting(); found = true; }
+        if (all || name == "reports") { tripReports(); found = true; }
+        if (all || name == "scheduler") { tripScheduler(); found = true; }
+        if (all || name == "history") { historySnapshots(); found = true; }
+        return found;
+    }
+};
+
+// Main function
+int main(int argc, char* argv[]) {
+    string hierarchyPath;
+    string landmarkPath;
+    string importDirectory;
+    string snapshotPath;
+    string tripsPath = "travel_data.txt";
+    
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--bench") {
+            string name = i + 1 < argc ? argv[i + 1] : "all";
+            if (!PlannerBenchmarks::run(name)) {
+                cout << "Unknown benchmark: " << name << "\n";
+                return 1;
+            }
+            return 0;
+        } else if (arg == "--ch" && i + 1 < argc) {
+            hierarchyPath = argv[++i];
+        } else if (arg == "--alt" && i + 1 < argc) {
+            landmarkPath = argv[++i];
+        } else if (arg == "--import" && i + 1 < argc) {
+            importDirectory = argv[++i];
+        } else if (arg == "--snapshot" && i + 1 < argc) {
+            snapshotPath = argv[++i];
+        } else if (arg == "--trips" && i + 1 < argc) {
+            tripsPath = argv[++i];
+        }
+    }
+    
+    cout << "Welcome to Smart Travel Planner!\n";
+    
+    TravelPlannerManager planner(false);
+    if (snapshotPath.empty() || !planner.attachSnapshot(snapshotPath)) {
+        cout << "Initializing system with sample data...\n";
+        planner.initializeSampleData();
+    }
+    if (!importDirectory.empty()) {
+        planner.importCatalog(importDirectory);
+    }
+    if (!hierarchyPath.empty()) {
+        planner.enableContractionHierarchy(hierarchyPath);
+    }
+    if (!landmarkPath.empty()) {
+        planner.enableLandmarks(landmarkPath);
+    }
+    planner.loadTrips(tripsPath);
+    planner.run();
+    
+    return 0;
 }
\ No newline at end of file